@@ -1,10 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <limits.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 // Ajuste de limites para eficiência de memória
+#ifndef MAX_NODES
 #define MAX_NODES 2000000 
+#endif
+#ifndef MAX_GENES
 #define MAX_GENES 30000   
+#endif
+#define MAX_ERROS 8         // Limite de mismatches aceito no modo aproximado
+#define MAX_PALAVRAS_SA 4   // Painéis com até 4*64 bases usam Shift-And
+#define MIN_NOS_PARALELO 65536  // Abaixo disso o build_ac serial é mais rápido
+#define MIN_NIVEL_PARALELO 2048 // Níveis menores que isso rodam numa thread só
 
 typedef struct {
     int id_gene;
@@ -21,6 +35,11 @@ typedef struct {
 TrieNode *nodes;
 int nodes_count = 1;
 
+// Limites efetivos da Trie e do pool de genes. Os #define são o piso; main
+// aumenta conforme a entrada e o --bench dimensiona cada painel gerado.
+long max_nos = MAX_NODES;
+long max_genes = MAX_GENES;
+
 NodeLista *pool;
 int pool_ptr = 1;
 
@@ -32,20 +51,36 @@ char *buffer_arq;
 long pos_buf = 0;
 long len_buf = 0;
 
+// Posição de cada gene dentro do buffer (usado pelo modo aproximado)
+long *gene_ini;
+int *gene_tam;
+int *gene_no;       // Nó da Trie onde cada gene termina
+
+// Estruturas extras para edições incrementais do painel (só com --edicoes)
+int *pai;           // Pai de cada nó (distingue arestas reais de transições)
+int *prof;          // Profundidade de cada nó
+int *fail_filho, *fail_prox, *fail_ant; // Árvore de falhas como listas duplamente ligadas
+int *nivel_ini;     // Onde cada profundidade começa dentro de q_bfs
+int max_nivel = 0;
+
 void setup_mapa() {
     for(int i = 0; i < 256; i++) mapa_base[i] = -1;
     mapa_base['A'] = 0; mapa_base['C'] = 1; 
     mapa_base['G'] = 2; mapa_base['T'] = 3;
 }
 
-// Inserção na Trie para múltiplos padrões
-void insert(char *s, int id_global) {
+// Inserção na Trie para múltiplos padrões; devolve o nó final do gene
+int insert(char *s, int id_global) {
     int u = 0;
     for (int i = 0; s[i]; i++) {
         int c = mapa_base[(unsigned char)s[i]];
         if (c == -1) continue;
         if (!nodes[u].next[c]) {
             nodes[u].next[c] = nodes_count++;
+            if (pai) {
+                pai[nodes[u].next[c]] = u;
+                prof[nodes[u].next[c]] = prof[u] + 1;
+            }
         }
         u = nodes[u].next[c];
     }
@@ -53,11 +88,85 @@ void insert(char *s, int id_global) {
     pool[p].id_gene = id_global;
     pool[p].next = nodes[u].head_gene;
     nodes[u].head_gene = p;
+    return u;
+}
+
+// Inserção a partir de bases já codificadas (0..3), usada pelas sementes
+void insert_codigos(const unsigned char *c, int len, int id_global) {
+    int u = 0;
+    for (int i = 0; i < len; i++) {
+        if (!nodes[u].next[c[i]]) {
+            nodes[u].next[c[i]] = nodes_count++;
+        }
+        u = nodes[u].next[c[i]];
+    }
+    int p = pool_ptr++;
+    pool[p].id_gene = id_global;
+    pool[p].next = nodes[u].head_gene;
+    nodes[u].head_gene = p;
 }
 
 int *q_bfs;
+
+// Construção por níveis: cada profundidade só depende da anterior, então
+// todos os nós de um nível são processados em paralelo. Uma soma de prefixos
+// sobre a quantidade de filhos reais põe cada filho na mesma posição de
+// q_bfs que o BFS serial usaria, e o autômato sai idêntico.
+void build_ac_niveis() {
+    int *off = malloc(sizeof(int) * nodes_count);
+    int t = 0;
+    for (int i = 0; i < 4; i++) {
+        if (nodes[0].next[i]) q_bfs[t++] = nodes[0].next[i];
+    }
+
+    int ini = 0, fim = t;
+    while (ini < fim) {
+        int n = fim - ini;
+#ifdef _OPENMP
+        #pragma omp parallel for if(n >= MIN_NIVEL_PARALELO)
+#endif
+        for (int j = 0; j < n; j++) {
+            int u = q_bfs[ini + j], c = 0;
+            for (int i = 0; i < 4; i++) c += nodes[u].next[i] != 0;
+            off[j] = c;
+        }
+        int soma = fim;
+        for (int j = 0; j < n; j++) {
+            int c = off[j];
+            off[j] = soma;
+            soma += c;
+        }
+#ifdef _OPENMP
+        #pragma omp parallel for if(n >= MIN_NIVEL_PARALELO)
+#endif
+        for (int j = 0; j < n; j++) {
+            int u = q_bfs[ini + j];
+            int f = nodes[u].fail;
+            int pos = off[j];
+            for (int i = 0; i < 4; i++) {
+                int v = nodes[u].next[i];
+                if (v) {
+                    nodes[v].fail = nodes[f].next[i];
+                    q_bfs[pos++] = v;
+                } else {
+                    nodes[u].next[i] = nodes[f].next[i];
+                }
+            }
+        }
+        ini = fim;
+        fim = soma;
+    }
+    free(off);
+}
+
 // Construção das falhas do algoritmo Aho-Corasick
 void build_ac() {
+#ifdef _OPENMP
+    if (nodes_count >= MIN_NOS_PARALELO && omp_get_max_threads() > 1) {
+        build_ac_niveis();
+        return;
+    }
+#endif
     int h = 0, t = 0;
     for (int i = 0; i < 4; i++) {
         if (nodes[0].next[i]) q_bfs[t++] = nodes[0].next[i];
@@ -77,6 +186,731 @@ void build_ac() {
     }
 }
 
+// Links de dicionário: estado mais próximo na cadeia de falhas que tem saída.
+// Permite listar todas as ocorrências que terminam numa posição em O(hits).
+int *dict_link;
+
+void build_dict_links() {
+    dict_link[0] = 0;
+    for (int i = 0; i < nodes_count - 1; i++) {
+        int u = q_bfs[i];
+        int f = nodes[u].fail;
+        dict_link[u] = nodes[f].head_gene ? f : dict_link[f];
+    }
+}
+
+// ============================================================================
+// MODO APROXIMADO (até k mismatches)
+// Pigeonhole: cada gene é cortado em k+1 pedaços; uma ocorrência com até k
+// erros contém pelo menos um pedaço exato. Os pedaços (sementes) vão para o
+// Aho-Corasick e cada acerto é verificado comparando 32 bases por palavra.
+// ============================================================================
+
+uint64_t *dna_pack;     // DNA com 2 bits por base (apenas bases válidas)
+long dna_n = 0;
+
+uint64_t *gene_pack;    // Genes empacotados, cada um alinhado numa palavra
+long *gene_word;        // Primeira palavra de cada gene em gene_pack
+int *gene_n;            // Quantidade de bases válidas de cada gene
+
+int *semente_gene;      // Gene dono de cada semente
+int *semente_fim;       // Posição (exclusiva) no gene onde a semente termina
+
+void empacotar_dna(const char *dna) {
+    long len = (long)strlen(dna);
+    dna_pack = calloc(len / 32 + 2, sizeof(uint64_t));
+    dna_n = 0;
+    for (long i = 0; i < len; i++) {
+        int c = mapa_base[(unsigned char)dna[i]];
+        if (c == -1) continue;
+        dna_pack[dna_n >> 5] |= (uint64_t)c << (2 * (dna_n & 31));
+        dna_n++;
+    }
+}
+
+// Janela de 32 bases do DNA começando na base p
+static inline uint64_t janela_dna(long p) {
+    int s = (int)(p & 31) * 2;
+    uint64_t w = dna_pack[p >> 5] >> s;
+    if (s) w |= dna_pack[(p >> 5) + 1] << (64 - s);
+    return w;
+}
+
+// Conta mismatches entre o gene g e o DNA a partir da base ini, parando em k+1
+int contar_erros(int g, long ini, int k) {
+    int n = gene_n[g];
+    const uint64_t *gw = &gene_pack[gene_word[g]];
+    int erros = 0;
+    for (int j = 0; j * 32 < n; j++) {
+        uint64_t x = janela_dna(ini + j * 32) ^ gw[j];
+        x = (x | (x >> 1)) & 0x5555555555555555ULL;
+        int resto = n - j * 32;
+        if (resto < 32) x &= (1ULL << (2 * resto)) - 1;
+        erros += __builtin_popcountll(x);
+        if (erros > k) break;
+    }
+    return erros;
+}
+
+// Codifica os genes, empacota e insere as k+1 sementes de cada um na Trie
+void preparar_sementes(int qtd_genes, int k) {
+    long total_palavras = 0;
+    for (int g = 0; g < qtd_genes; g++) total_palavras += gene_tam[g] / 32 + 1;
+
+    gene_pack = calloc(total_palavras, sizeof(uint64_t));
+    gene_word = malloc(sizeof(long) * qtd_genes);
+    gene_n = malloc(sizeof(int) * qtd_genes);
+    semente_gene = malloc(sizeof(int) * qtd_genes * (k + 1));
+    semente_fim = malloc(sizeof(int) * qtd_genes * (k + 1));
+    unsigned char *cod = malloc(len_buf + 1);
+
+    long w = 0;
+    int qtd_sementes = 0;
+    for (int g = 0; g < qtd_genes; g++) {
+        int n = 0;
+        for (int i = 0; i < gene_tam[g]; i++) {
+            int c = mapa_base[(unsigned char)buffer_arq[gene_ini[g] + i]];
+            if (c != -1) cod[n++] = (unsigned char)c;
+        }
+        gene_word[g] = w;
+        gene_n[g] = n;
+        for (int i = 0; i < n; i++) gene_pack[w + (i >> 5)] |= (uint64_t)cod[i] << (2 * (i & 31));
+        w += n / 32 + 1;
+
+        // Genes com até k bases casam em qualquer lugar (se couberem no DNA)
+        if (n <= k) {
+            if (n <= dna_n) gene_found[g] = 1;
+            continue;
+        }
+        for (int j = 0; j <= k; j++) {
+            int ini = (int)((long)j * n / (k + 1));
+            int fim = (int)((long)(j + 1) * n / (k + 1));
+            semente_gene[qtd_sementes] = g;
+            semente_fim[qtd_sementes] = fim;
+            insert_codigos(&cod[ini], fim - ini, qtd_sementes++);
+        }
+    }
+    free(cod);
+}
+
+// Varre o DNA empacotado; cada semente encontrada propõe um alinhamento
+// do gene inteiro, que é confirmado se tiver no máximo k mismatches
+void varrer_aproximado(int k) {
+    int u = 0;
+    for (long i = 0; i < dna_n; i++) {
+        int c = (int)((dna_pack[i >> 5] >> (2 * (i & 31))) & 3);
+        u = nodes[u].next[c];
+        for (int s = nodes[u].head_gene ? u : dict_link[u]; s; s = dict_link[s]) {
+            for (int p = nodes[s].head_gene; p; p = pool[p].next) {
+                int g = semente_gene[pool[p].id_gene];
+                if (gene_found[g]) continue;
+                long ini = i + 1 - semente_fim[pool[p].id_gene];
+                if (ini < 0 || ini + gene_n[g] > dna_n) continue;
+                if (contar_erros(g, ini, k) <= k) gene_found[g] = 1;
+            }
+        }
+    }
+}
+
+// Avança o autômato por um trecho do DNA a partir do estado u,
+// marcando os estados alcançados; devolve o estado final
+int avancar_exato(const char *dna, int u, char *visited) {
+    for (const char *c = dna; *c; c++) {
+        int idx = mapa_base[(unsigned char)*c];
+        if (idx != -1) {
+            u = nodes[u].next[idx];
+            visited[u] = 1;
+        }
+    }
+    return u;
+}
+
+// q_bfs guarda só os nodes_count - 1 estados fora da raiz
+void propagar_visitados(char *visited) {
+    for (int i = nodes_count - 2; i >= 0; i--) {
+        int curr = q_bfs[i];
+        if (visited[curr]) {
+            visited[nodes[curr].fail] = 1;
+            int p = nodes[curr].head_gene;
+            while (p) {
+                gene_found[pool[p].id_gene] = 1;
+                p = pool[p].next;
+            }
+        }
+    }
+}
+
+// Scan exato: marca os estados alcançados e propaga pelas falhas.
+// Ao final, visited[x] == 1 sse a cadeia do nó x ocorre no DNA.
+void varrer_exato(const char *dna, char *visited) {
+    avancar_exato(dna, 0, visited);
+    propagar_visitados(visited);
+}
+
+// ============================================================================
+// SHIFT-AND MULTI-PADRÃO (painéis pequenos)
+// Todos os genes são concatenados num vetor de bits de até MAX_PALAVRAS_SA
+// palavras. A cada base: D = ((D << 1) | inicios) & B[base]. Um bit de fim
+// ligado em D indica o gene encontrado. Sem Trie e sem tabela de transições.
+// ============================================================================
+
+// Painel cabe no Shift-And? (genes vazios ficam com o Aho-Corasick)
+int shift_and_cabe(int qtd_genes) {
+    long total = 0;
+    for (int g = 0; g < qtd_genes; g++) {
+        int n = 0;
+        for (const char *c = &buffer_arq[gene_ini[g]]; *c; c++) {
+            if (mapa_base[(unsigned char)*c] != -1) n++;
+        }
+        if (n == 0) return 0;
+        total += n;
+        if (total > 64 * MAX_PALAVRAS_SA) return 0;
+    }
+    return 1;
+}
+
+static inline void marcar_fins(uint64_t m, int w, uint64_t *fins, const int *dono) {
+    while (m) {
+        int b = __builtin_ctzll(m);
+        gene_found[dono[w * 64 + b]] = 1;
+        fins[w] &= ~(1ULL << b);   // Gene já encontrado não precisa mais ser testado
+        m &= m - 1;
+    }
+}
+
+void varrer_shift_and(const char *dna, int qtd_genes) {
+    uint64_t B[4][MAX_PALAVRAS_SA] = {{0}};
+    uint64_t ini[MAX_PALAVRAS_SA] = {0}, fins[MAX_PALAVRAS_SA] = {0};
+    int dono[64 * MAX_PALAVRAS_SA];
+    int bit = 0;
+
+    for (int g = 0; g < qtd_genes; g++) {
+        int primeiro = 1;
+        for (const char *c = &buffer_arq[gene_ini[g]]; *c; c++) {
+            int b = mapa_base[(unsigned char)*c];
+            if (b == -1) continue;
+            B[b][bit >> 6] |= 1ULL << (bit & 63);
+            if (primeiro) ini[bit >> 6] |= 1ULL << (bit & 63);
+            primeiro = 0;
+            bit++;
+        }
+        fins[(bit - 1) >> 6] |= 1ULL << ((bit - 1) & 63);
+        dono[bit - 1] = g;
+    }
+    int W = (bit + 63) / 64;
+
+    if (W == 1) {
+        // Caso mais comum: uma palavra, tudo em registradores
+        uint64_t D = 0, i0 = ini[0];
+        uint64_t b0 = B[0][0], b1 = B[1][0], b2 = B[2][0], b3 = B[3][0];
+        for (const char *c = dna; *c && fins[0]; c++) {
+            int b = mapa_base[(unsigned char)*c];
+            if (b == -1) continue;
+            uint64_t m = (b == 0) ? b0 : (b == 1) ? b1 : (b == 2) ? b2 : b3;
+            D = ((D << 1) | i0) & m;
+            if (D & fins[0]) marcar_fins(D & fins[0], 0, fins, dono);
+        }
+        return;
+    }
+
+    uint64_t D[MAX_PALAVRAS_SA] = {0};
+    for (const char *c = dna; *c; c++) {
+        int b = mapa_base[(unsigned char)*c];
+        if (b == -1) continue;
+        uint64_t vai = 0, achou = 0;
+        for (int w = 0; w < W; w++) {
+            uint64_t novo = (D[w] << 1) | vai | ini[w];
+            vai = D[w] >> 63;
+            D[w] = novo & B[b][w];
+            achou |= D[w] & fins[w];
+        }
+        if (achou) {
+            uint64_t resta = 0;
+            for (int w = 0; w < W; w++) {
+                if (D[w] & fins[w]) marcar_fins(D[w] & fins[w], w, fins, dono);
+                resta |= fins[w];
+            }
+            if (!resta) break;
+        }
+    }
+}
+
+// ============================================================================
+// EDIÇÃO INCREMENTAL DO AUTÔMATO
+// Um nó novo só altera: a transição do pai, as transições pela mesma base dos
+// nós da subárvore de falhas do pai (até esbarrar num filho real) e a falha
+// desses filhos reais. O restante do autômato fica intacto.
+// ============================================================================
+
+int *pilha_inc, *ordem_inc;
+
+void ligar_fail(int v, int f) {
+    fail_ant[v] = 0;
+    fail_prox[v] = fail_filho[f];
+    if (fail_filho[f]) fail_ant[fail_filho[f]] = v;
+    fail_filho[f] = v;
+}
+
+void desligar_fail(int v) {
+    int f = nodes[v].fail;
+    if (fail_ant[v]) fail_prox[fail_ant[v]] = fail_prox[v];
+    else fail_filho[f] = fail_prox[v];
+    if (fail_prox[v]) fail_ant[fail_prox[v]] = fail_ant[v];
+}
+
+// Prepara árvore de falhas e níveis de q_bfs depois do build_ac
+void preparar_incremental() {
+    fail_filho = calloc(max_nos, sizeof(int));
+    fail_prox = calloc(max_nos, sizeof(int));
+    fail_ant = calloc(max_nos, sizeof(int));
+    nivel_ini = calloc(max_nos + 2, sizeof(int));
+    pilha_inc = malloc(sizeof(int) * max_nos);
+    ordem_inc = malloc(sizeof(int) * max_nos);
+
+    int t = nodes_count - 1;
+    for (int i = 0; i < t; i++) ligar_fail(q_bfs[i], nodes[q_bfs[i]].fail);
+
+    // q_bfs já está ordenada por profundidade
+    max_nivel = t ? prof[q_bfs[t - 1]] : 0;
+    int i = 0;
+    for (int d = 1; d <= max_nivel + 1; d++) {
+        while (i < t && prof[q_bfs[i]] < d) i++;
+        nivel_ini[d] = i;
+    }
+}
+
+// Encaixa o nó no fim do seu nível: o primeiro de cada nível mais fundo
+// desce para o fim do próprio nível, O(profundidade) em vez de O(nós)
+void inserir_na_ordem(int n) {
+    int t = nodes_count - 2;  // Posição livre (n já foi contado)
+    int d = prof[n];
+    if (d > max_nivel) {
+        for (int l = max_nivel + 1; l <= d + 1; l++) nivel_ini[l] = t;
+        max_nivel = d;
+    }
+    int pos = t;
+    for (int l = max_nivel; l > d; l--) {
+        q_bfs[pos] = q_bfs[nivel_ini[l]];
+        pos = nivel_ini[l];
+        nivel_ini[l]++;
+    }
+    q_bfs[pos] = n;
+    nivel_ini[max_nivel + 1] = t + 1;
+}
+
+// Cria a folha n (filho de p pela base c) num autômato já construído
+int inserir_no(int p, int c) {
+    int n = nodes_count++;
+    pai[n] = p;
+    prof[n] = prof[p] + 1;
+    nodes[p].next[c] = n;
+
+    int f = p ? nodes[nodes[p].fail].next[c] : 0;
+    nodes[n].fail = f;
+    nodes[n].head_gene = 0;
+    for (int i = 0; i < 4; i++) nodes[n].next[i] = nodes[f].next[i];
+    ligar_fail(n, f);
+    inserir_na_ordem(n);
+
+    // Coleta a subárvore de falhas de p em pré-ordem, podando nos nós que
+    // já têm filho real pela base c (abaixo deles nada muda)
+    int topo = 0, qtd = 0;
+    for (int v = fail_filho[p]; v; v = fail_prox[v]) pilha_inc[topo++] = v;
+    int *ordem = ordem_inc;
+    while (topo) {
+        int y = pilha_inc[--topo];
+        ordem[qtd++] = y;
+        int z = nodes[y].next[c];
+        if (z && pai[z] == y) continue;
+        for (int v = fail_filho[y]; v; v = fail_prox[v]) pilha_inc[topo++] = v;
+    }
+
+    for (int i = 0; i < qtd; i++) {
+        int y = ordem[i];
+        int g = nodes[nodes[y].fail].next[c];
+        int z = nodes[y].next[c];
+        if (z && pai[z] == y) {
+            if (nodes[z].fail != g) {
+                desligar_fail(z);
+                nodes[z].fail = g;
+                ligar_fail(z, g);
+            }
+        } else {
+            nodes[y].next[c] = g;
+        }
+    }
+    return n;
+}
+
+// ============================================================================
+// RELATÓRIO DE POSIÇÕES (--posicoes / --posicoes-bin)
+// Cada thread varre um bloco do DNA empacotado com seu próprio buffer de
+// hits; o bloco começa max_len-1 bases antes para não perder ocorrências
+// que atravessam a fronteira. Os links de dicionário tornam a listagem
+// das saídas de cada posição O(hits).
+// ============================================================================
+
+typedef struct {
+    int gene;
+    long pos;       // Posição inicial da ocorrência (em bases válidas)
+} Hit;
+
+typedef struct {
+    Hit *v;
+    long n, cap;
+} BufferHits;
+
+static inline void hits_push(BufferHits *b, int gene, long pos) {
+    if (b->n == b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 4096;
+        b->v = realloc(b->v, sizeof(Hit) * b->cap);
+    }
+    b->v[b->n].gene = gene;
+    b->v[b->n].pos = pos;
+    b->n++;
+}
+
+// Conta as bases válidas de cada gene (o tamanho cru pode ter lixo)
+int contar_bases_genes(int qtd_genes) {
+    int max_len = 1;
+    gene_n = malloc(sizeof(int) * (qtd_genes + 1));
+    for (int g = 0; g < qtd_genes; g++) {
+        int n = 0;
+        for (int i = 0; i < gene_tam[g]; i++) {
+            if (mapa_base[(unsigned char)buffer_arq[gene_ini[g] + i]] != -1) n++;
+        }
+        gene_n[g] = n;
+        if (n > max_len) max_len = n;
+    }
+    return max_len;
+}
+
+void varrer_posicoes(BufferHits *buf, int n_blocos, int max_len) {
+    long passo = (dna_n + n_blocos - 1) / n_blocos;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static, 1)
+#endif
+    for (int b = 0; b < n_blocos; b++) {
+        long ini = b * passo;
+        long fim = ini + passo;
+        if (fim > dna_n) fim = dna_n;
+        long i = ini - (max_len - 1);
+        if (i < 0) i = 0;
+        int u = 0;
+        for (; i < fim; i++) {
+            int c = (int)((dna_pack[i >> 5] >> (2 * (i & 31))) & 3);
+            u = nodes[u].next[c];
+            if (i < ini) continue;
+            for (int s = nodes[u].head_gene ? u : dict_link[u]; s; s = dict_link[s]) {
+                for (int p = nodes[s].head_gene; p; p = pool[p].next) {
+                    int g = pool[p].id_gene;
+                    hits_push(&buf[b], g, i + 1 - gene_n[g]);
+                }
+            }
+        }
+    }
+}
+
+// Saída bufferizada com formatação própria de inteiros
+typedef struct {
+    FILE *f;
+    char *v;
+    long n;
+} Escritor;
+
+#define TAM_ESCRITOR (1 << 20)
+
+static inline void esc_flush(Escritor *e) {
+    fwrite(e->v, 1, e->n, e->f);
+    e->n = 0;
+}
+
+static inline void esc_long(Escritor *e, long x, char sep) {
+    if (e->n > TAM_ESCRITOR - 32) esc_flush(e);
+    char tmp[24];
+    int k = 0;
+    do { tmp[k++] = (char)('0' + x % 10); x /= 10; } while (x);
+    while (k) e->v[e->n++] = tmp[--k];
+    e->v[e->n++] = sep;
+}
+
+// LEB128: 7 bits por byte, bit alto indica continuação
+static inline void esc_varint(Escritor *e, uint64_t x) {
+    if (e->n > TAM_ESCRITOR - 16) esc_flush(e);
+    while (x >= 0x80) { e->v[e->n++] = (char)(x | 0x80); x >>= 7; }
+    e->v[e->n++] = (char)x;
+}
+
+// Agrupa os hits por gene (counting sort, O(hits)) e grava o relatório.
+// Texto: uma linha "gene qtd pos1 pos2 ..." por gene encontrado.
+// Binário: "SQH1", uint32 qtd_genes e, para cada gene, varint(qtd)
+// seguido dos deltas das posições em varint.
+void relatar_posicoes(BufferHits *buf, int n_blocos, int qtd_genes, const char *path, int binario) {
+    long *cont = calloc(qtd_genes + 1, sizeof(long));
+    long total = 0;
+    for (int b = 0; b < n_blocos; b++) {
+        for (long i = 0; i < buf[b].n; i++) cont[buf[b].v[i].gene + 1]++;
+        total += buf[b].n;
+    }
+    for (int g = 0; g < qtd_genes; g++) {
+        gene_found[g] = cont[g + 1] > 0;
+        cont[g + 1] += cont[g];
+    }
+    long *pos = malloc(sizeof(long) * (total + 1));
+    long *ocup = malloc(sizeof(long) * (qtd_genes + 1));
+    memcpy(ocup, cont, sizeof(long) * (qtd_genes + 1));
+    // Blocos em ordem: as posições de cada gene já saem crescentes
+    for (int b = 0; b < n_blocos; b++) {
+        for (long i = 0; i < buf[b].n; i++) pos[ocup[buf[b].v[i].gene]++] = buf[b].v[i].pos;
+        free(buf[b].v);
+    }
+    free(ocup);
+
+    Escritor e;
+    e.f = fopen(path, "wb");
+    if (e.f) {
+        e.v = malloc(TAM_ESCRITOR);
+        e.n = 0;
+        if (binario) {
+            uint32_t q = (uint32_t)qtd_genes;
+            fwrite("SQH1", 1, 4, e.f);
+            fwrite(&q, sizeof(q), 1, e.f);
+            for (int g = 0; g < qtd_genes; g++) {
+                esc_varint(&e, (uint64_t)(cont[g + 1] - cont[g]));
+                long ant = 0;
+                for (long i = cont[g]; i < cont[g + 1]; i++) {
+                    esc_varint(&e, (uint64_t)(pos[i] - ant));
+                    ant = pos[i];
+                }
+            }
+        } else {
+            for (int g = 0; g < qtd_genes; g++) {
+                long q = cont[g + 1] - cont[g];
+                if (!q) continue;
+                esc_long(&e, g, ' ');
+                esc_long(&e, q, ' ');
+                for (long i = cont[g]; i < cont[g + 1]; i++) {
+                    esc_long(&e, pos[i], i + 1 < cont[g + 1] ? ' ' : '\n');
+                }
+            }
+        }
+        esc_flush(&e);
+        free(e.v);
+        fclose(e.f);
+    }
+    free(pos);
+    free(cont);
+}
+
+// ============================================================================
+// ÍNDICE FM DO GENOMA (--gravar-indice / --indice)
+// O genoma é indexado uma vez (SA-IS -> BWT 2 bits + contadores a cada 64
+// linhas) e gravado em disco. Cada gene passa a ser respondido por busca
+// reversa em O(tamanho do gene), sem varrer o DNA de novo.
+// Limite: genomas com menos de 2^31 bases (índices int no SA-IS).
+// ============================================================================
+
+typedef struct {
+    uint32_t occ[4];    // Ocorrências de cada base antes deste bloco
+    uint64_t bits[2];   // 64 símbolos da BWT, 2 bits cada
+} BlocoFM;
+
+typedef struct {
+    int64_t n;          // Bases do genoma (a BWT tem n+1 símbolos)
+    int64_t primario;   // Linha onde a BWT tem o '$'
+    int64_t C[5];       // Primeira linha de cada base na ordem ordenada
+    int64_t n_blocos;
+    BlocoFM *blocos;
+} IndiceFM;
+
+static void sais_buckets(const int *T, int n, int K, int *bkt, int fim) {
+    memset(bkt, 0, sizeof(int) * (K + 1));
+    for (int i = 0; i < n; i++) bkt[T[i]]++;
+    int soma = 0;
+    for (int c = 0; c <= K; c++) {
+        soma += bkt[c];
+        bkt[c] = fim ? soma : soma - bkt[c];
+    }
+}
+
+#define SAIS_LMS(i) ((i) > 0 && tipo_s[i] && !tipo_s[(i) - 1])
+
+static void sais_induzir(const int *T, int *SA, int n, int K, const char *tipo_s, int *bkt) {
+    sais_buckets(T, n, K, bkt, 0);
+    for (int i = 0; i < n; i++) {
+        int j = SA[i] - 1;
+        if (SA[i] > 0 && !tipo_s[j]) SA[bkt[T[j]]++] = j;
+    }
+    sais_buckets(T, n, K, bkt, 1);
+    for (int i = n - 1; i >= 0; i--) {
+        int j = SA[i] - 1;
+        if (SA[i] > 0 && tipo_s[j]) SA[--bkt[T[j]]] = j;
+    }
+}
+
+// SA-IS (Nong, Zhang & Chan): T[n-1] deve ser o sentinela 0, único e menor
+void sais(const int *T, int *SA, int n, int K) {
+    if (n == 1) { SA[0] = 0; return; }
+    char *tipo_s = malloc(n);
+    int *bkt = malloc(sizeof(int) * (K + 1));
+    tipo_s[n - 1] = 1;
+    for (int i = n - 2; i >= 0; i--) {
+        tipo_s[i] = T[i] < T[i + 1] || (T[i] == T[i + 1] && tipo_s[i + 1]);
+    }
+
+    // 1. Ordena as substrings LMS por indução
+    sais_buckets(T, n, K, bkt, 1);
+    for (int i = 0; i < n; i++) SA[i] = -1;
+    for (int i = 1; i < n; i++) {
+        if (SAIS_LMS(i)) SA[--bkt[T[i]]] = i;
+    }
+    sais_induzir(T, SA, n, K, tipo_s, bkt);
+
+    // 2. Compacta as LMS ordenadas e dá nomes às substrings distintas
+    int n1 = 0;
+    for (int i = 0; i < n; i++) {
+        if (SAIS_LMS(SA[i])) SA[n1++] = SA[i];
+    }
+    for (int i = n1; i < n; i++) SA[i] = -1;
+    int nome = 0, ant = -1;
+    for (int i = 0; i < n1; i++) {
+        int pos = SA[i], diff = 0;
+        for (int d = 0; d < n; d++) {
+            if (ant == -1 || T[pos + d] != T[ant + d] || tipo_s[pos + d] != tipo_s[ant + d]) {
+                diff = 1;
+                break;
+            }
+            if (d > 0 && (SAIS_LMS(pos + d) || SAIS_LMS(ant + d))) break;
+        }
+        if (diff) { nome++; ant = pos; }
+        SA[n1 + pos / 2] = nome - 1;
+    }
+    for (int i = n - 1, j = n - 1; i >= n1; i--) {
+        if (SA[i] >= 0) SA[j--] = SA[i];
+    }
+
+    // 3. Resolve a string reduzida (recursão só se houver nomes repetidos)
+    int *SA1 = SA, *s1 = SA + n - n1;
+    if (nome < n1) sais(s1, SA1, n1, nome - 1);
+    else for (int i = 0; i < n1; i++) SA1[s1[i]] = i;
+
+    // 4. Induz o SA final a partir das LMS já na ordem correta
+    sais_buckets(T, n, K, bkt, 1);
+    for (int i = 1, j = 0; i < n; i++) {
+        if (SAIS_LMS(i)) s1[j++] = i;
+    }
+    for (int i = 0; i < n1; i++) SA1[i] = s1[SA1[i]];
+    for (int i = n1; i < n; i++) SA[i] = -1;
+    for (int i = n1 - 1; i >= 0; i--) {
+        int j = SA[i];
+        SA[i] = -1;
+        SA[--bkt[T[j]]] = j;
+    }
+    sais_induzir(T, SA, n, K, tipo_s, bkt);
+
+    free(bkt);
+    free(tipo_s);
+}
+
+void construir_fm(IndiceFM *fm, const char *dna) {
+    long len = (long)strlen(dna);
+    int *T = malloc(sizeof(int) * (len + 1));
+    int n = 0;
+    for (long i = 0; i < len; i++) {
+        int c = mapa_base[(unsigned char)dna[i]];
+        if (c != -1) T[n++] = c + 1;
+    }
+    T[n] = 0;
+    int *SA = malloc(sizeof(int) * (n + 1));
+    sais(T, SA, n + 1, 4);
+
+    fm->n = n;
+    fm->n_blocos = (n + 1) / 64 + 1;
+    fm->blocos = calloc(fm->n_blocos, sizeof(BlocoFM));
+    int64_t cont[4] = {0};
+    for (int64_t i = 0; i <= n; i++) {
+        BlocoFM *b = &fm->blocos[i >> 6];
+        if ((i & 63) == 0) {
+            for (int c = 0; c < 4; c++) b->occ[c] = (uint32_t)cont[c];
+        }
+        int c = 0;  // O '$' é guardado como A e descontado em occ_fm
+        if (SA[i] == 0) fm->primario = i;
+        else {
+            c = T[SA[i] - 1] - 1;
+            cont[c]++;
+        }
+        b->bits[(i >> 5) & 1] |= (uint64_t)c << (2 * (i & 31));
+    }
+    // Bloco final (consultado com i = n+1) quando n+1 cai na fronteira
+    if (((n + 1) & 63) == 0) {
+        for (int c = 0; c < 4; c++) fm->blocos[(n + 1) >> 6].occ[c] = (uint32_t)cont[c];
+    }
+    fm->C[0] = 1;
+    for (int c = 0; c < 4; c++) fm->C[c + 1] = fm->C[c] + cont[c];
+    free(SA);
+    free(T);
+}
+
+// Ocorrências da base c nas linhas [0, i) da BWT
+static inline int64_t occ_fm(const IndiceFM *fm, int c, int64_t i) {
+    const BlocoFM *b = &fm->blocos[i >> 6];
+    int64_t r = b->occ[c];
+    uint64_t padrao = 0x5555555555555555ULL * (uint64_t)c;
+    int resto = (int)(i & 63);
+    for (int w = 0; w < 2 && resto > 0; w++) {
+        uint64_t x = b->bits[w] ^ padrao;
+        x = ~(x | (x >> 1)) & 0x5555555555555555ULL;
+        if (resto < 32) x &= (1ULL << (2 * resto)) - 1;
+        r += __builtin_popcountll(x);
+        resto -= 32;
+    }
+    if (c == 0 && fm->primario < i && fm->primario >= (i & ~63LL)) r--;
+    return r;
+}
+
+// Busca reversa: 1 se o gene ocorre no genoma indexado
+int buscar_fm(const IndiceFM *fm, const char *gene) {
+    int64_t l = 0, r = fm->n + 1;
+    for (long k = (long)strlen(gene) - 1; k >= 0 && l < r; k--) {
+        int c = mapa_base[(unsigned char)gene[k]];
+        if (c == -1) continue;
+        l = fm->C[c] + occ_fm(fm, c, l);
+        r = fm->C[c] + occ_fm(fm, c, r);
+    }
+    return l < r;
+}
+
+int gravar_fm(const IndiceFM *fm, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return 0;
+    int ok = fwrite("SQFM", 1, 4, f) == 4 &&
+             fwrite(&fm->n, sizeof(int64_t), 1, f) == 1 &&
+             fwrite(&fm->primario, sizeof(int64_t), 1, f) == 1 &&
+             fwrite(fm->C, sizeof(int64_t), 5, f) == 5 &&
+             fwrite(&fm->n_blocos, sizeof(int64_t), 1, f) == 1 &&
+             fwrite(fm->blocos, sizeof(BlocoFM), fm->n_blocos, f) == (size_t)fm->n_blocos;
+    fclose(f);
+    return ok;
+}
+
+int carregar_fm(IndiceFM *fm, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    char magico[4];
+    int ok = fread(magico, 1, 4, f) == 4 && memcmp(magico, "SQFM", 4) == 0 &&
+             fread(&fm->n, sizeof(int64_t), 1, f) == 1 &&
+             fread(&fm->primario, sizeof(int64_t), 1, f) == 1 &&
+             fread(fm->C, sizeof(int64_t), 5, f) == 5 &&
+             fread(&fm->n_blocos, sizeof(int64_t), 1, f) == 1 &&
+             fm->n_blocos == (fm->n + 1) / 64 + 1;
+    if (ok) {
+        fm->blocos = malloc(sizeof(BlocoFM) * fm->n_blocos);
+        ok = fread(fm->blocos, sizeof(BlocoFM), fm->n_blocos, f) == (size_t)fm->n_blocos;
+    }
+    fclose(f);
+    return ok;
+}
+
 typedef struct {
     char codigo[50];
     int qtd_genes;
@@ -102,6 +936,349 @@ void ordenar(Doenca *d, int n) {
     }
 }
 
+void pontuar(Doenca *d) {
+    int enc = 0;
+    for (int k = 0; k < d->qtd_genes; k++) {
+        if (gene_found[d->gene_ids[k]]) enc++;
+    }
+    if (d->qtd_genes > 0)
+        d->percentual = (enc * 100 + d->qtd_genes / 2) / d->qtd_genes;
+    else 
+        d->percentual = 0;
+}
+
+void escrever_ranking(const char *path, Doenca *d, int n) {
+    FILE *fout = fopen(path, "w");
+    if (fout) {
+        for (int i = 0; i < n; i++) {
+            fprintf(fout, "%s->%d%%\n", d[i].codigo, d[i].percentual);
+        }
+        fclose(fout);
+    }
+}
+
+// Próximo token do buffer (terminado em '\0'), ou NULL no fim
+char *proximo_token(char *buf, long *pos, long len) {
+    while (*pos < len && buf[*pos] <= 32) (*pos)++;
+    if (*pos >= len) return NULL;
+    char *tok = &buf[*pos];
+    while (*pos < len && buf[*pos] > 32) (*pos)++;
+    buf[*pos] = '\0';
+    (*pos)++;
+    return tok;
+}
+
+// Caminha pelas arestas reais; devolve o nó final ou -1 se o gene não está na Trie
+int achar_no(const char *s) {
+    int u = 0;
+    for (int i = 0; s[i]; i++) {
+        int c = mapa_base[(unsigned char)s[i]];
+        if (c == -1) continue;
+        int v = nodes[u].next[c];
+        if (!v || pai[v] != u) return -1;
+        u = v;
+    }
+    return u;
+}
+
+// Edições do painel em lotes. Cada linha do arquivo é uma operação:
+//   + CODIGO GENE   adiciona o gene à doença (cria a doença se não existir)
+//   - CODIGO GENE   remove o gene da doença
+//   =               fecha o lote e grava o ranking em <saida>.<lote>
+// Só as doenças tocadas são repontuadas. Genes que terminam em nós já
+// existentes são resolvidos pelo visited em cache; nós novos nascem como
+// "desconhecidos" (2) e só eles exigem uma nova passada pelo DNA, feita no
+// autômato remendado (sem reconstruir). Remoções são lógicas: o gene sai da
+// lista de saída do nó, mas os nós continuam na Trie sem afetar o resultado.
+void aplicar_edicoes(const char *path, const char *out_path, Doenca **lista, int *qtd_doencas,
+                     int *qtd_genes, const char *dna, char *visited) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    rewind(f);
+    char *buf = malloc(len + 1);   // Mantido vivo: os genes apontam para ele
+    if (fread(buf, 1, len, f) != (size_t)len) { fclose(f); free(buf); return; }
+    buf[len] = '\0';
+    fclose(f);
+
+    char *tocada = calloc(*qtd_doencas + 1, sizeof(char));
+    int cap_doencas = *qtd_doencas;
+    int *novos = malloc(sizeof(int) * max_nos);
+    int qtd_novos = 0;
+    int lote = 0, ops_lote = 0;
+    char nome[4096];
+    long pos = 0;
+
+    for (;;) {
+        char *op = proximo_token(buf, &pos, len);
+        if (!op || op[0] == '=') {
+            if (ops_lote > 0 || op) {
+                if (qtd_novos > 0) {
+                    // Nós novos ainda não observados: uma passada no autômato atual
+                    for (int i = 0; i < qtd_novos; i++) visited[novos[i]] = 0;
+                    varrer_exato(dna, visited);
+                    qtd_novos = 0;
+                }
+                for (int i = 0; i < *qtd_doencas; i++) {
+                    if (tocada[(*lista)[i].id_orig]) {
+                        pontuar(&(*lista)[i]);
+                        tocada[(*lista)[i].id_orig] = 0;
+                    }
+                }
+                ordenar(*lista, *qtd_doencas);
+                snprintf(nome, sizeof(nome), "%s.%d", out_path, ++lote);
+                escrever_ranking(nome, *lista, *qtd_doencas);
+                ops_lote = 0;
+            }
+            if (!op) break;
+            continue;
+        }
+
+        char *codigo = proximo_token(buf, &pos, len);
+        char *gene = proximo_token(buf, &pos, len);
+        if (!codigo || !gene) break;
+        ops_lote++;
+
+        Doenca *d = NULL;
+        for (int i = 0; i < *qtd_doencas; i++) {
+            if (strcmp((*lista)[i].codigo, codigo) == 0) { d = &(*lista)[i]; break; }
+        }
+
+        if (op[0] == '+') {
+            if (pool_ptr >= max_genes + 100 || nodes_count + (long)strlen(gene) > max_nos) {
+                fprintf(stderr, "Painel cheio, ignorando gene de %s\n", codigo);
+                continue;
+            }
+            if (!d) {
+                if (*qtd_doencas == cap_doencas) {
+                    cap_doencas = cap_doencas * 2 + 1;
+                    *lista = realloc(*lista, sizeof(Doenca) * cap_doencas);
+                    tocada = realloc(tocada, cap_doencas + 1);
+                }
+                d = &(*lista)[*qtd_doencas];
+                snprintf(d->codigo, sizeof(d->codigo), "%s", codigo);
+                d->qtd_genes = 0;
+                d->gene_ids = NULL;
+                d->percentual = 0;
+                d->id_orig = *qtd_doencas;
+                tocada[d->id_orig] = 0;
+                (*qtd_doencas)++;
+            }
+
+            int u = 0;
+            for (int i = 0; gene[i]; i++) {
+                int c = mapa_base[(unsigned char)gene[i]];
+                if (c == -1) continue;
+                int v = nodes[u].next[c];
+                if (v && pai[v] == u) u = v;
+                else {
+                    u = inserir_no(u, c);
+                    visited[u] = 2;
+                    novos[qtd_novos++] = u;
+                }
+            }
+            int id = (*qtd_genes)++;
+            int p = pool_ptr++;
+            pool[p].id_gene = id;
+            pool[p].next = nodes[u].head_gene;
+            nodes[u].head_gene = p;
+            gene_no[id] = u;
+            gene_found[id] = (visited[u] == 1);
+
+            d->gene_ids = realloc(d->gene_ids, sizeof(int) * (d->qtd_genes + 1));
+            d->gene_ids[d->qtd_genes++] = id;
+            tocada[d->id_orig] = 1;
+        } else if (op[0] == '-' && d) {
+            int u = achar_no(gene);
+            if (u < 0) continue;
+            for (int k = 0; k < d->qtd_genes; k++) {
+                int id = d->gene_ids[k];
+                if (gene_no[id] != u) continue;
+                d->gene_ids[k] = d->gene_ids[--d->qtd_genes];
+                int *link = &nodes[u].head_gene;
+                while (*link && pool[*link].id_gene != id) link = &pool[*link].next;
+                if (*link) *link = pool[*link].next;
+                tocada[d->id_orig] = 1;
+                break;
+            }
+        }
+    }
+
+    free(novos);
+    free(tocada);
+}
+
+// ============================================================================
+// BENCHMARK (--bench)
+// Gera genomas (aleatórios e repetitivos) e painéis sintéticos e mede em
+// separado: construção do autômato, memória, varredura (bases/s) e ranking.
+// O genoma é gerado e varrido em blocos, então 10 GB não precisam caber na
+// RAM. A Trie e o pool de genes são alocados do tamanho de cada painel
+// (até soma dos tamanhos + 1 nós), então 100k e 1M genes rodam sem -D; só é
+// pulado o painel cuja alocação falhar. A grade vai até --bench-max-genes e
+// --bench-max-mb (1M genes pede --bench-max-genes 1000000).
+// ============================================================================
+
+#define BENCH_BLOCO (1 << 22)
+
+static uint64_t bench_rng;
+
+static inline uint64_t bench_rand() {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 7;
+    bench_rng ^= bench_rng << 17;
+    return bench_rng;
+}
+
+double agora() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Preenche um bloco do genoma; o repetitivo é um motivo curto em tandem com 1% de mutação
+void bench_gerar_bloco(char *buf, long n, int repetitivo, const char *motivo, int per) {
+    static long fase = 0;
+    if (!buf) { fase = 0; return; }
+    for (long i = 0; i < n; i++) {
+        uint64_t r = bench_rand();
+        if (repetitivo && (r >> 40) % 100) buf[i] = motivo[fase % per];
+        else buf[i] = "ACGT"[r & 3];
+        fase++;
+    }
+    buf[n] = '\0';
+}
+
+// Realoca Trie, pool, fila do BFS, visited e gene_found para um painel de
+// 'genes' genes com até 'nos' nós; devolve 0 se faltar memória
+int bench_dimensionar(long genes, long nos, char **visited) {
+    free(nodes); free(pool); free(q_bfs); free(*visited); free(gene_found);
+    max_nos = nos;
+    max_genes = genes;
+    nodes = calloc(max_nos, sizeof(TrieNode));
+    pool = malloc(sizeof(NodeLista) * (max_genes + 100));
+    q_bfs = malloc(sizeof(int) * max_nos);
+    *visited = calloc(max_nos, sizeof(char));
+    gene_found = calloc(max_genes + 100, sizeof(char));
+    return nodes && pool && q_bfs && *visited && gene_found;
+}
+
+void executar_bench(long max_mb, long limite_genes) {
+    static const long tam_mb[] = {1, 10, 100, 1000, 10000};
+    static const long qtd_genes[] = {10, 1000, 10000, 100000, 1000000};
+    static const char *dist_nome[] = {"curto20", "longo300", "misto10-600"};
+    const int genes_por_doenca = 20;
+
+    char *bloco = malloc(BENCH_BLOCO + 1);
+    char *amostra = malloc(BENCH_BLOCO + 1);
+    char motivo[64];
+    for (int i = 0; i < 63; i++) motivo[i] = "ACGT"[(i * 7 + i / 5) & 3];
+    motivo[63] = '\0';
+    char *visited = NULL;
+
+    printf("Grade: paineis ate %ld genes (--bench-max-genes), genomas ate %ld MB (--bench-max-mb)\n",
+           limite_genes, max_mb);
+    printf("%-9s %-12s %9s %8s %9s %9s %-11s %10s %11s %9s\n", "genes", "dist", "nos", "mem_MB",
+           "build_s", "genoma_MB", "tipo", "scan_s", "bases/s", "rank_s");
+
+    // Amostra fixa de genoma aleatório para sortear genes que de fato ocorrem
+    bench_rng = 88172645463325252ULL;
+    bench_gerar_bloco(amostra, BENCH_BLOCO, 0, motivo, 63);
+
+    for (int pg = 0; pg < 5 && qtd_genes[pg] <= limite_genes; pg++) {
+        for (int d = 0; d < 3; d++) {
+            long G = qtd_genes[pg];
+
+            // Gera o painel e mede a construção (insert + build_ac)
+            bench_rng = 0x9E3779B97F4A7C15ULL ^ (uint64_t)(pg * 3 + d);
+            char **genes = malloc(sizeof(char *) * G);
+            long soma = 0;
+            for (long g = 0; g < G; g++) {
+                int L = d == 0 ? 20 : d == 1 ? 300 : 10 + (int)(bench_rand() % 591);
+                genes[g] = malloc(L + 1);
+                if (bench_rand() & 1) {
+                    long p = (long)(bench_rand() % (BENCH_BLOCO - L));
+                    memcpy(genes[g], &amostra[p], L);
+                } else {
+                    for (int i = 0; i < L; i++) genes[g][i] = "ACGT"[bench_rand() & 3];
+                }
+                genes[g][L] = '\0';
+                soma += L;
+            }
+            if (soma + 1 > INT_MAX || !bench_dimensionar(G, soma + 1, &visited)) {
+                printf("%-9ld %-12s pulado: sem memoria para %ld nos (%.0f MB)\n", G, dist_nome[d], soma + 1,
+                       (soma + 1.0) * (sizeof(TrieNode) + sizeof(int) + 1) / 1048576.0);
+                for (long g = 0; g < G; g++) free(genes[g]);
+                free(genes);
+                continue;
+            }
+            nodes_count = 1;
+            pool_ptr = 1;
+            double t0 = agora();
+            for (long g = 0; g < G; g++) insert(genes[g], (int)g);
+            build_ac();
+            double t_build = agora() - t0;
+            double mem = (nodes_count * (sizeof(TrieNode) + sizeof(int) + 1.0) +
+                          pool_ptr * sizeof(NodeLista)) / 1048576.0;
+
+            int qtd_doencas = (int)((G + genes_por_doenca - 1) / genes_por_doenca);
+            Doenca *lista = malloc(sizeof(Doenca) * qtd_doencas);
+            for (int i = 0; i < qtd_doencas; i++) {
+                snprintf(lista[i].codigo, sizeof(lista[i].codigo), "D%d", i);
+                lista[i].id_orig = i;
+                lista[i].gene_ids = malloc(sizeof(int) * genes_por_doenca);
+                lista[i].qtd_genes = 0;
+            }
+            for (long g = 0; g < G; g++) {
+                Doenca *x = &lista[g / genes_por_doenca];
+                x->gene_ids[x->qtd_genes++] = (int)g;
+            }
+
+            for (int t = 0; t < 5 && tam_mb[t] <= max_mb; t++) {
+                for (int rep = 0; rep < 2; rep++) {
+                    memset(visited, 0, nodes_count);
+                    memset(gene_found, 0, G);
+                    long total = tam_mb[t] << 20;
+                    double t_scan = 0;
+                    int u = 0;
+                    bench_rng = 88172645463325252ULL;
+                    bench_gerar_bloco(NULL, 0, 0, motivo, 63);
+                    for (long feito = 0; feito < total; feito += BENCH_BLOCO) {
+                        long n = total - feito < BENCH_BLOCO ? total - feito : BENCH_BLOCO;
+                        bench_gerar_bloco(bloco, n, rep, motivo, 63);  // Geração fora do tempo
+                        double ts = agora();
+                        u = avancar_exato(bloco, u, visited);
+                        t_scan += agora() - ts;
+                    }
+                    double ts = agora();
+                    propagar_visitados(visited);
+                    t_scan += agora() - ts;
+
+                    double tr = agora();
+                    for (int i = 0; i < qtd_doencas; i++) pontuar(&lista[i]);
+                    ordenar(lista, qtd_doencas);
+                    double t_rank = agora() - tr;
+
+                    // Cada byte do genoma é uma base
+                    printf("%-9ld %-12s %9d %8.1f %9.4f %9ld %-11s %10.4f %11.3e %9.4f\n", G,
+                           dist_nome[d], nodes_count, mem, t_build, tam_mb[t],
+                           rep ? "repetitivo" : "aleatorio", t_scan, total / t_scan, t_rank);
+                    fflush(stdout);
+                }
+            }
+
+            for (int i = 0; i < qtd_doencas; i++) free(lista[i].gene_ids);
+            free(lista);
+            for (long g = 0; g < G; g++) free(genes[g]);
+            free(genes);
+        }
+    }
+    free(visited);
+    free(amostra);
+    free(bloco);
+}
+
 int fast_read_int() {
     int x = 0;
     while (pos_buf < len_buf && buffer_arq[pos_buf] <= 32) pos_buf++;
@@ -114,13 +1291,63 @@ int fast_read_int() {
 
 int main(int argc, char *argv[]) {
     setup_mapa();
+
+    // Argumentos: [entrada] [saida] [--k N] [--edicoes arquivo]
+    //             [--posicoes arquivo | --posicoes-bin arquivo] [--motor auto|ac]
+    //             [--gravar-indice arquivo | --indice arquivo]
+    //             [--bench [--bench-max-mb N] [--bench-max-genes N]]
+    char *in_path = "sequenciamento.input.txt";
+    char *out_path = "sequenciamento.output.txt";
+    char *edicoes_path = NULL;
+    char *posicoes_path = NULL;
+    int posicoes_bin = 0;
+    char *motor = "auto";
+    char *indice_path = NULL;
+    int gravar_indice = 0;
+    int bench = 0;
+    long bench_max_mb = 100, bench_max_genes = 100000;
+    int k_erros = 0;
+    int n_pos = 0;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--k") == 0 && a + 1 < argc) k_erros = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--edicoes") == 0 && a + 1 < argc) edicoes_path = argv[++a];
+        else if (strcmp(argv[a], "--posicoes") == 0 && a + 1 < argc) posicoes_path = argv[++a];
+        else if (strcmp(argv[a], "--motor") == 0 && a + 1 < argc) motor = argv[++a];
+        else if (strcmp(argv[a], "--indice") == 0 && a + 1 < argc) indice_path = argv[++a];
+        else if (strcmp(argv[a], "--bench") == 0) bench = 1;
+        else if (strcmp(argv[a], "--bench-max-mb") == 0 && a + 1 < argc) bench_max_mb = atol(argv[++a]);
+        else if (strcmp(argv[a], "--bench-max-genes") == 0 && a + 1 < argc) bench_max_genes = atol(argv[++a]);
+        else if (strcmp(argv[a], "--gravar-indice") == 0 && a + 1 < argc) {
+            indice_path = argv[++a];
+            gravar_indice = 1;
+        }
+        else if (strcmp(argv[a], "--posicoes-bin") == 0 && a + 1 < argc) {
+            posicoes_path = argv[++a];
+            posicoes_bin = 1;
+        }
+        else if (n_pos == 0) { in_path = argv[a]; n_pos++; }
+        else if (n_pos == 1) { out_path = argv[a]; n_pos++; }
+    }
+    if (k_erros < 0 || k_erros > MAX_ERROS) {
+        // Reduzir k mudaria a pergunta: a busca responderia outra distância
+        fprintf(stderr, "--k deve estar entre 0 e %d (MAX_ERROS)\n", MAX_ERROS);
+        return 1;
+    }
+    if (indice_path && (edicoes_path || posicoes_path || k_erros > 0)) {
+        fprintf(stderr, "O índice FM responde só o ranking exato; ignorando --k/--edicoes/--posicoes\n");
+        edicoes_path = posicoes_path = NULL;
+        k_erros = 0;
+    }
+    if ((edicoes_path || posicoes_path) && k_erros > 0) {
+        fprintf(stderr, "--edicoes/--posicoes usam o modo exato; ignorando --k\n");
+        k_erros = 0;
+    }
     
-    nodes = calloc(MAX_NODES, sizeof(TrieNode));
-    pool = malloc(sizeof(NodeLista) * (MAX_GENES + 100));
-    q_bfs = malloc(sizeof(int) * MAX_NODES);
-    char *visited = calloc(MAX_NODES, sizeof(char));
+    if (bench) {
+        executar_bench(bench_max_mb, bench_max_genes);
+        return 0;
+    }
     
-    char *in_path = (argc > 1) ? argv[1] : "sequenciamento.input.txt";
     FILE *f = fopen(in_path, "rb");
     if (!f) return 1;
     fseek(f, 0, SEEK_END);
@@ -139,9 +1366,41 @@ int main(int argc, char *argv[]) {
     buffer_arq[pos_buf] = '\0'; // Finaliza a string do DNA no buffer
     pos_buf++;
 
+    // Limites a partir da própria entrada: cada gene é um token do painel e
+    // cada base cria no máximo um nó (as sementes do modo aproximado também).
+    // As edições podem acrescentar até o tamanho do arquivo delas.
+    long tokens = 0, bytes = len_buf - pos_buf;
+    for (long i = pos_buf; i < len_buf; i++) {
+        if (buffer_arq[i] > 32 && buffer_arq[i - 1] <= 32) tokens++;
+    }
+    if (edicoes_path) {
+        FILE *fe = fopen(edicoes_path, "rb");
+        if (fe) {
+            fseek(fe, 0, SEEK_END);
+            long extra = ftell(fe);
+            fclose(fe);
+            bytes += extra;
+            tokens += extra / 2;
+        }
+    }
+    if (tokens > max_genes) max_genes = tokens;
+    if (bytes + 1 > max_nos) max_nos = bytes + 1 < INT_MAX ? bytes + 1 : INT_MAX;
+
+    nodes = calloc(max_nos, sizeof(TrieNode));
+    pool = malloc(sizeof(NodeLista) * (max_genes + 100) * (k_erros + 1));
+    q_bfs = malloc(sizeof(int) * max_nos);
+    char *visited = calloc(max_nos, sizeof(char));
+    if (edicoes_path) {
+        pai = calloc(max_nos, sizeof(int));
+        prof = calloc(max_nos, sizeof(int));
+    }
+
     int qtd_doencas = fast_read_int();
     Doenca *lista_doencas = malloc(sizeof(Doenca) * qtd_doencas);
-    gene_found = calloc(MAX_GENES + 100, sizeof(char));
+    gene_found = calloc(max_genes + 100, sizeof(char));
+    gene_ini = malloc(sizeof(long) * (max_genes + 100));
+    gene_tam = malloc(sizeof(int) * (max_genes + 100));
+    gene_no = malloc(sizeof(int) * (max_genes + 100));
 
     int global_id_count = 0;
     for(int i = 0; i < qtd_doencas; i++) {
@@ -160,59 +1419,79 @@ int main(int argc, char *argv[]) {
             while (pos_buf < len_buf && buffer_arq[pos_buf] <= 32) pos_buf++;
             int g_ini = pos_buf;
             while (pos_buf < len_buf && buffer_arq[pos_buf] > 32) pos_buf++;
-            char original_char = buffer_arq[pos_buf];
-            buffer_arq[pos_buf] = '\0';
+            buffer_arq[pos_buf] = '\0'; // Finaliza o gene no próprio buffer
             
             lista_doencas[i].gene_ids[k] = global_id_count;
-            insert(&buffer_arq[g_ini], global_id_count++);
-            
-            buffer_arq[pos_buf] = original_char;
+            gene_ini[global_id_count] = g_ini;
+            gene_tam[global_id_count] = pos_buf - g_ini;
+            global_id_count++;
         }
     }
 
-    build_ac();
-
-    int u = 0;
-    for (char *c = dna_ptr; *c; c++) {
-        int idx = mapa_base[(unsigned char)*c];
-        if (idx != -1) {
-            u = nodes[u].next[idx];
-            visited[u] = 1;
-        }
+    // Painel pequeno e sem modos extras: Shift-And dispensa a Trie
+    int usar_sa = !indice_path && k_erros == 0 && !edicoes_path && !posicoes_path &&
+                  strcmp(motor, "ac") != 0 && shift_and_cabe(global_id_count);
+    if (!indice_path && k_erros == 0 && !usar_sa) {
+        for (int g = 0; g < global_id_count; g++) gene_no[g] = insert(&buffer_arq[gene_ini[g]], g);
     }
 
-    for (int i = nodes_count - 1; i >= 0; i--) {
-        int curr = q_bfs[i];
-        if (visited[curr]) {
-            visited[nodes[curr].fail] = 1;
-            int p = nodes[curr].head_gene;
-            while (p) {
-                gene_found[pool[p].id_gene] = 1;
-                p = pool[p].next;
+    if (indice_path) {
+        // Índice FM: o DNA da entrada só é lido ao gravar o índice
+        IndiceFM fm;
+        if (gravar_indice) {
+            construir_fm(&fm, dna_ptr);
+            if (!gravar_fm(&fm, indice_path)) {
+                fprintf(stderr, "Erro ao gravar o indice: %s\n", indice_path);
+                return 1;
             }
+        } else if (!carregar_fm(&fm, indice_path)) {
+            fprintf(stderr, "Indice invalido: %s\n", indice_path);
+            return 1;
         }
-    }
-
-    for (int i = 0; i < qtd_doencas; i++) {
-        int enc = 0;
-        for (int k = 0; k < lista_doencas[i].qtd_genes; k++) {
-            if (gene_found[lista_doencas[i].gene_ids[k]]) enc++;
+        for (int g = 0; g < global_id_count; g++) {
+            gene_found[g] = (char)buscar_fm(&fm, &buffer_arq[gene_ini[g]]);
         }
-        if (lista_doencas[i].qtd_genes > 0)
-            lista_doencas[i].percentual = (enc * 100 + lista_doencas[i].qtd_genes / 2) / lista_doencas[i].qtd_genes;
-        else 
-            lista_doencas[i].percentual = 0;
+        free(fm.blocos);
+    } else if (usar_sa) {
+        varrer_shift_and(dna_ptr, global_id_count);
+    } else if (k_erros > 0) {
+        // Modo aproximado: Trie de sementes + verificação bit a bit
+        empacotar_dna(dna_ptr);
+        preparar_sementes(global_id_count, k_erros);
+        build_ac();
+        dict_link = malloc(sizeof(int) * nodes_count);
+        build_dict_links();
+        varrer_aproximado(k_erros);
+    } else if (posicoes_path) {
+        // Modo relatório: hits por posição em vez de um bit por estado
+        build_ac();
+        dict_link = malloc(sizeof(int) * nodes_count);
+        build_dict_links();
+        empacotar_dna(dna_ptr);
+        int max_len = contar_bases_genes(global_id_count);
+        int n_blocos = 1;
+#ifdef _OPENMP
+        n_blocos = omp_get_max_threads();
+#endif
+        BufferHits *buf = calloc(n_blocos, sizeof(BufferHits));
+        varrer_posicoes(buf, n_blocos, max_len);
+        relatar_posicoes(buf, n_blocos, global_id_count, posicoes_path, posicoes_bin);
+        free(buf);
+        if (edicoes_path) varrer_exato(dna_ptr, visited); // Edições precisam do visited
+    } else {
+        build_ac();
+        varrer_exato(dna_ptr, visited);
     }
 
+    for (int i = 0; i < qtd_doencas; i++) pontuar(&lista_doencas[i]);
+
     ordenar(lista_doencas, qtd_doencas);
-    
-    char *out_path = (argc > 2) ? argv[2] : "sequenciamento.output.txt";
-    FILE *fout = fopen(out_path, "w");
-    if (fout) {
-        for (int i = 0; i < qtd_doencas; i++) {
-            fprintf(fout, "%s->%d%%\n", lista_doencas[i].codigo, lista_doencas[i].percentual);
-        }
-        fclose(fout);
+    escrever_ranking(out_path, lista_doencas, qtd_doencas);
+
+    if (edicoes_path) {
+        preparar_incremental();
+        aplicar_edicoes(edicoes_path, out_path, &lista_doencas, &qtd_doencas,
+                        &global_id_count, dna_ptr, visited);
     }
 
     return 0;
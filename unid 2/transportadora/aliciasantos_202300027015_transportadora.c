@@ -7,12 +7,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+// Entrada mapeada em memória onde há mmap; no Windows (MinGW) lê com um fread só
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+// Kernels SIMD só em x86 com gcc/clang; nos demais fica só o escalar
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TEM_SIMD_X86 1
+#include <immintrin.h>
+#endif
 
 // Definição das estruturas
 typedef struct {
     char codigo[20];
     double valor;
+    int64_t centavos; // Valor em centavos (modo --valores centavos)
     int peso;
     int volume;
     int carregado; // 0 = não, 1 = sim
@@ -24,197 +43,1906 @@ typedef struct {
     int cap_volume;
 } Veiculo;
 
+// Modos de memória da DP
+#define DP_AUTO 0      // Completa se couber no limite abaixo, senão compacta
+#define DP_COMPLETA 1  // Guarda as n+1 camadas de valores
+#define DP_COMPACTA 2  // Só 2 camadas de valores + 1 bit de decisão por célula
+
+// Acima disso (em bytes) o modo automático troca a tabela completa pela compacta
+#define LIMITE_DP_COMPLETA (512LL * 1024 * 1024)
+
+// Paralelismo por camada: só compensa com camadas grandes (em células)
+#define MIN_CELULAS_PARALELO (1 << 16)
+// Alvo de bytes por bloco de linhas (linha atual + as duas lidas) ~ metade da L2
+#define BYTES_BLOCO_LINHAS (128 * 1024)
+
+int modo_dp = DP_AUTO;
+
+// Representação dos valores na DP
+#define VALOR_REAL 0      // double, como lido do arquivo
+#define VALOR_CENTAVOS 1  // inteiro em centavos: soma e comparação exatas
+
+// Tipo da célula da tabela (no modo centavos usa int32 quando a soma cabe)
+#define CEL_DOUBLE 0
+#define CEL_I32 1
+#define CEL_I64 2
+
+int modo_valor = VALOR_REAL;
+
+// Motor de otimização por veículo
+#define MOTOR_AUTO 0    // DP densa se W x V for pequeno, senão Pareto
+#define MOTOR_DP 1
+#define MOTOR_PARETO 2
+#define MOTOR_BB 3      // Branch-and-bound (sem tabela; opcionalmente com tempo limite)
+
+// Acima de tantas células (W+1)(V+1) o modo automático usa a fronteira de Pareto
+#define LIMITE_CELULAS_DENSA (1 << 22)
+// Estados somados de todas as fronteiras antes de desistir do Pareto (16 bytes cada)
+#define LIMITE_ESTADOS_PARETO (32u * 1024 * 1024)
+// Um estado custa ~128 células da DP densa (intercalação + Fenwick vs. kernel SIMD);
+// passando de n*(W+1)*(V+1)/128 estados a tabela já teria sido mais rápida
+#define CUSTO_ESTADO_EM_CELULAS 128
+
+// Se nem a DP compacta couber nisso, o modo automático usa branch-and-bound
+#define LIMITE_DP_COMPACTA (2048LL * 1024 * 1024)
+
+// Orçamento padrão do branch-and-bound quando o modo automático o escolhe, para
+// um veículo de capacidade enorme não prender o manifesto (ou o lote) inteiro
+#define TEMPO_BB_PADRAO 10.0
+
+int motor = MOTOR_AUTO;
+// Orçamento por veículo do branch-and-bound em segundos (0 = sem limite;
+// -1 = não informado: TEMPO_BB_PADRAO no modo automático, sem limite com --motor bb)
+double tempo_bb = -1;
+
 // Função auxiliar para retornar o maior valor
 double max_val(double a, double b) {
     return (a > b) ? a : b;
 }
 
-// Função para liberar a memória da matriz 3D
-void liberar_matriz(double ***matriz, int n, int w) {
-    for (int i = 0; i <= n; i++) {
-        for (int j = 0; j <= w; j++) {
-            free(matriz[i][j]);
+// Aloca um bloco alinhado em 64 bytes (uma linha de cache).
+// 'base' guarda o ponteiro original, que é o que deve ir para o free.
+void *alocar_alinhado(size_t bytes, void **base) {
+    *base = malloc(bytes + 64);
+    if (!*base) return NULL;
+    return (void *)(((uintptr_t)*base + 63) & ~(uintptr_t)63);
+}
+
+// ==================== LEITURA E ESCRITA ====================
+
+typedef struct {
+    const char *p;
+    const char *fim;
+    char *dados;    // Início do arquivo (mapeado ou lido)
+    size_t tam;
+    int mapeado;
+} Leitor;
+
+int abrir_leitor(Leitor *l, const char *caminho) {
+    memset(l, 0, sizeof(Leitor));
+#ifndef _WIN32
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            l->dados = (char *)m;
+            l->tam = (size_t)st.st_size;
+            l->mapeado = 1;
         }
-        free(matriz[i]);
     }
-    free(matriz);
+    close(fd);
+    if (!l->mapeado) {
+#endif
+        FILE *f = fopen(caminho, "rb");
+        if (!f) return 0;
+        fseek(f, 0, SEEK_END);
+        long tam = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        l->dados = (char *)malloc(tam > 0 ? (size_t)tam : 1);
+        l->tam = (tam > 0) ? fread(l->dados, 1, (size_t)tam, f) : 0;
+        fclose(f);
+#ifndef _WIN32
+    }
+#endif
+    l->p = l->dados;
+    l->fim = l->dados + l->tam;
+    return 1;
 }
 
-// Função principal de otimização (Algoritmo da Mochila 3D)
-void processar_carga(Veiculo caminhao, Item *itens, int qtd_itens, FILE *saida) {
-    int W = caminhao.cap_peso;
-    int V = caminhao.cap_volume;
-    
-    // Mapear apenas itens ainda não carregados
-    int itens_disponiveis = 0;
-    int *indices_map = (int *)malloc(qtd_itens * sizeof(int)); 
-    
-    for (int i = 0; i < qtd_itens; i++) {
-        if (!itens[i].carregado) {
-            indices_map[itens_disponiveis] = i;
-            itens_disponiveis++;
+void fechar_leitor(Leitor *l) {
+#ifndef _WIN32
+    if (l->mapeado) {
+        munmap(l->dados, l->tam);
+        return;
+    }
+#endif
+    free(l->dados);
+}
+
+static inline void pular_espacos(Leitor *l) {
+    while (l->p < l->fim && (unsigned char)*l->p <= ' ') l->p++;
+}
+
+// Próxima palavra (como o %s do scanf), truncada em max-1 caracteres
+int ler_palavra(Leitor *l, char *dst, size_t max) {
+    pular_espacos(l);
+    if (l->p >= l->fim) return 0;
+    size_t k = 0;
+    while (l->p < l->fim && (unsigned char)*l->p > ' ') {
+        if (k + 1 < max) dst[k++] = *l->p;
+        l->p++;
+    }
+    dst[k] = '\0';
+    return 1;
+}
+
+int ler_int(Leitor *l, int *x) {
+    pular_espacos(l);
+    int neg = 0;
+    if (l->p < l->fim && (*l->p == '-' || *l->p == '+')) neg = *l->p++ == '-';
+    if (l->p >= l->fim || *l->p < '0' || *l->p > '9') return 0;
+    long v = 0;
+    while (l->p < l->fim && *l->p >= '0' && *l->p <= '9') v = v * 10 + (*l->p++ - '0');
+    *x = (int)(neg ? -v : v);
+    return 1;
+}
+
+// Decimal em ponto fixo: mantissa inteira e número de casas. Com mantissa
+// < 2^53 e até 22 casas, mantissa / 10^casas é uma única divisão exata de
+// operandos exatos, então dá o mesmo double do strtod. Fora disso (expoente,
+// dígitos demais) usa o strtod. Os centavos saem direto da mantissa.
+int ler_decimal(Leitor *l, double *valor, int64_t *centavos) {
+    static const double pot10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    pular_espacos(l);
+    const char *ini = l->p;
+    int neg = 0;
+    if (l->p < l->fim && (*l->p == '-' || *l->p == '+')) neg = *l->p++ == '-';
+    uint64_t mant = 0;
+    int digitos = 0, casas = 0, ponto = 0;
+    while (l->p < l->fim) {
+        char c = *l->p;
+        if (c >= '0' && c <= '9') {
+            if (mant < (1ULL << 53) / 10) mant = mant * 10 + (uint64_t)(c - '0');
+            else digitos = 100; // Não cabe: vai pelo strtod
+            digitos++;
+            casas += ponto;
+        } else if (c == '.' && !ponto) {
+            ponto = 1;
+        } else {
+            break;
         }
+        l->p++;
     }
+    if (digitos == 0) return 0;
+    if (digitos > 100 || casas > 22 || (l->p < l->fim && (*l->p == 'e' || *l->p == 'E'))) {
+        char tmp[64];
+        while (l->p < l->fim && (unsigned char)*l->p > ' ') l->p++;
+        size_t k = (size_t)(l->p - ini) < sizeof(tmp) - 1 ? (size_t)(l->p - ini) : sizeof(tmp) - 1;
+        memcpy(tmp, ini, k);
+        tmp[k] = '\0';
+        *valor = strtod(tmp, NULL);
+        *centavos = llround(*valor * 100);
+        return 1;
+    }
+    double v = (double)mant / pot10[casas];
+    *valor = neg ? -v : v;
+    if (casas <= 2) {
+        int64_t c = (int64_t)mant * (casas == 0 ? 100 : casas == 1 ? 10 : 1);
+        *centavos = neg ? -c : c;
+    } else {
+        *centavos = llround(*valor * 100);
+    }
+    return 1;
+}
 
-    int n = itens_disponiveis;
+// Saída acumulada num buffer e gravada em blocos grandes
+typedef struct {
+    FILE *f;
+    char *v;
+    long n;
+} Escritor;
+
+#define TAM_ESCRITOR (1 << 20)
+
+static inline void esc_flush(Escritor *e) {
+    fwrite(e->v, 1, e->n, e->f);
+    e->n = 0;
+}
+
+static inline void esc_txt(Escritor *e, const char *s) {
+    while (*s) {
+        if (e->n >= TAM_ESCRITOR) esc_flush(e);
+        e->v[e->n++] = *s++;
+    }
+}
+
+static inline void esc_char(Escritor *e, char c) {
+    if (e->n >= TAM_ESCRITOR) esc_flush(e);
+    e->v[e->n++] = c;
+}
 
-    // 1. Alocação Dinâmica DP (n+1) x (W+1) x (V+1)
-    double ***dp = (double ***)malloc((n + 1) * sizeof(double **));
-    for (int i = 0; i <= n; i++) {
-        dp[i] = (double **)malloc((W + 1) * sizeof(double *));
-        for (int j = 0; j <= W; j++) {
-            dp[i][j] = (double *)calloc((V + 1), sizeof(double));
+static inline void esc_int(Escritor *e, long long x) {
+    if (e->n > TAM_ESCRITOR - 32) esc_flush(e);
+    if (x < 0) {
+        e->v[e->n++] = '-';
+        x = -x;
+    }
+    char tmp[24];
+    int k = 0;
+    do { tmp[k++] = (char)('0' + x % 10); x /= 10; } while (x);
+    while (k) e->v[e->n++] = tmp[--k];
+}
+
+// Igual ao printf("%.2f"): arredonda o valor binário exato de x*100 para o
+// inteiro mais próximo, empate para o par. O fma calcula x*100 - (r ± 0.5)
+// com um só arredondamento, o que preserva o sinal e o zero.
+void esc_real2(Escritor *e, double x) {
+    if (signbit(x)) { // O printf também escreve "-0.00"
+        esc_char(e, '-');
+        x = -x;
+    }
+    double r = nearbyint(x * 100);
+    double acima = fma(x, 100, -(r + 0.5));
+    double abaixo = fma(x, 100, -(r - 0.5));
+    if (acima > 0 || (acima == 0 && fmod(r + 1, 2) == 0)) r += 1;
+    else if (abaixo < 0 || (abaixo == 0 && fmod(r - 1, 2) == 0)) r -= 1;
+    long long c = (long long)r;
+    esc_int(e, c / 100);
+    esc_char(e, '.');
+    esc_char(e, (char)('0' + (c / 10) % 10));
+    esc_char(e, (char)('0' + c % 10));
+}
+
+// ==================== ARENA DA EXECUÇÃO ====================
+// Memória de trabalho de processar_carga/motor_dp, reaproveitada entre veículos
+// (uma por manifesto sendo resolvido, então cada thread do modo lote tem a sua).
+// Alocar é só avançar um deslocamento; o que não couber vai para blocos extras
+// que são liberados no reinício, e aí o bloco principal cresce até o pico visto.
+// Depois do maior veículo não há mais malloc/free e as páginas continuam quentes.
+
+typedef struct BlocoExtra {
+    struct BlocoExtra *prox;
+    void *base;
+} BlocoExtra;
+
+typedef struct {
+    void *base;         // Ponteiro do malloc do bloco principal
+    char *ini;          // Início alinhado
+    size_t cap;
+    size_t usado;
+    size_t pico;        // Total pedido desde o último reinício (principal + extras)
+    BlocoExtra *extras;
+} Arena;
+
+// Garante um bloco principal de pelo menos 'bytes' (só chamar com a arena vazia)
+void arena_reservar(Arena *a, size_t bytes) {
+    if (bytes <= a->cap) return;
+    free(a->base);
+    a->ini = (char *)alocar_alinhado(bytes, &a->base);
+    a->cap = a->ini ? bytes : 0;
+}
+
+void *arena_alocar(Arena *a, size_t bytes) {
+    bytes = (bytes + 63) & ~(size_t)63; // Cada pedaço começa numa linha de cache
+    a->pico += bytes;
+    if (a->usado + bytes <= a->cap) {
+        void *p = a->ini + a->usado;
+        a->usado += bytes;
+        return p;
+    }
+    BlocoExtra *extra = (BlocoExtra *)malloc(sizeof(BlocoExtra));
+    void *p = extra ? alocar_alinhado(bytes, &extra->base) : NULL;
+    if (!p) {
+        printf("Memoria insuficiente (%zu bytes)\n", bytes);
+        exit(1);
+    }
+    extra->prox = a->extras;
+    a->extras = extra;
+    return p;
+}
+
+// Esvazia a arena entre veículos
+void arena_reiniciar(Arena *a) {
+    int cresceu = a->extras != NULL;
+    while (a->extras) {
+        BlocoExtra *prox = a->extras->prox;
+        free(a->extras->base);
+        free(a->extras);
+        a->extras = prox;
+    }
+    if (cresceu) arena_reservar(a, a->pico);
+    a->usado = 0;
+    a->pico = 0;
+}
+
+void arena_liberar(Arena *a) {
+    arena_reiniciar(a);
+    free(a->base);
+    memset(a, 0, sizeof(Arena));
+}
+
+// Calcula a linha de peso fixo w da camada i a partir da camada i-1.
+// linha_levar aponta para a linha w - peso_item da camada anterior.
+// Se 'bits' não for NULL, liga o bit v quando levar o item foi estritamente melhor
+// (mesmo critério do backtracking da tabela completa: dp[i] != dp[i-1]).
+void calcular_linha_escalar(double *linha, const double *linha_ant, const double *linha_levar,
+                    int V, int vol_item, double valor_item, uint64_t *bits) {
+    int v = 0;
+    for (; v <= V && v < vol_item; v++) {
+        linha[v] = linha_ant[v];
+    }
+    for (; v <= V; v++) {
+        double nao_levar = linha_ant[v];
+        double levar = linha_levar[v - vol_item] + valor_item;
+        linha[v] = max_val(nao_levar, levar);
+        if (bits && levar > nao_levar) bits[v >> 6] |= 1ULL << (v & 63);
+    }
+}
+
+// Versões inteiras (centavos) do mesmo kernel
+void calcular_linha_i32_escalar(int32_t *linha, const int32_t *linha_ant, const int32_t *linha_levar,
+                                int V, int vol_item, int32_t valor_item, uint64_t *bits) {
+    int v = 0;
+    for (; v <= V && v < vol_item; v++) {
+        linha[v] = linha_ant[v];
+    }
+    for (; v <= V; v++) {
+        int32_t nao_levar = linha_ant[v];
+        int32_t levar = linha_levar[v - vol_item] + valor_item;
+        linha[v] = (nao_levar > levar) ? nao_levar : levar;
+        if (bits && levar > nao_levar) bits[v >> 6] |= 1ULL << (v & 63);
+    }
+}
+
+void calcular_linha_i64_escalar(int64_t *linha, const int64_t *linha_ant, const int64_t *linha_levar,
+                                int V, int vol_item, int64_t valor_item, uint64_t *bits) {
+    int v = 0;
+    for (; v <= V && v < vol_item; v++) {
+        linha[v] = linha_ant[v];
+    }
+    for (; v <= V; v++) {
+        int64_t nao_levar = linha_ant[v];
+        int64_t levar = linha_levar[v - vol_item] + valor_item;
+        linha[v] = (nao_levar > levar) ? nao_levar : levar;
+        if (bits && levar > nao_levar) bits[v >> 6] |= 1ULL << (v & 63);
+    }
+}
+
+#ifdef TEM_SIMD_X86
+// Liga no bitset os 'qtd' bits de 'mascara' a partir da coluna v
+// (pode atravessar a fronteira entre duas palavras de 64 bits)
+static inline void ligar_bits(uint64_t *bits, int v, unsigned mascara, int qtd) {
+    int desl = v & 63;
+    bits[v >> 6] |= (uint64_t)mascara << desl;
+    if (desl + qtd > 64) bits[(v >> 6) + 1] |= (uint64_t)mascara >> (64 - desl);
+}
+
+// Mesma recorrência do escalar, 4 colunas por vez. max_pd(a, b) devolve
+// (a > b) ? a : b, exatamente o max_val(nao_levar, levar), então o resultado
+// é idêntico bit a bit (só há uma soma por célula, sem FMA).
+__attribute__((target("avx2")))
+void calcular_linha_avx2(double *linha, const double *linha_ant, const double *linha_levar,
+                         int V, int vol_item, double valor_item, uint64_t *bits) {
+    int v = 0;
+    for (; v <= V && v < vol_item; v++) {
+        linha[v] = linha_ant[v];
+    }
+    __m256d val = _mm256_set1_pd(valor_item);
+    for (; v + 3 <= V; v += 4) {
+        __m256d nao_levar = _mm256_loadu_pd(linha_ant + v);
+        __m256d levar = _mm256_add_pd(_mm256_loadu_pd(linha_levar + v - vol_item), val);
+        _mm256_storeu_pd(linha + v, _mm256_max_pd(nao_levar, levar));
+        if (bits) {
+            unsigned m = (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(levar, nao_levar, _CMP_GT_OQ));
+            if (m) ligar_bits(bits, v, m, 4);
+        }
+    }
+    for (; v <= V; v++) {
+        double nao_levar = linha_ant[v];
+        double levar = linha_levar[v - vol_item] + valor_item;
+        linha[v] = max_val(nao_levar, levar);
+        if (bits && levar > nao_levar) bits[v >> 6] |= 1ULL << (v & 63);
+    }
+}
+
+// Versão de 2 colunas para CPUs sem AVX2 (SSE2 existe em todo x86-64)
+__attribute__((target("sse2")))
+void calcular_linha_sse2(double *linha, const double *linha_ant, const double *linha_levar,
+                         int V, int vol_item, double valor_item, uint64_t *bits) {
+    int v = 0;
+    for (; v <= V && v < vol_item; v++) {
+        linha[v] = linha_ant[v];
+    }
+    __m128d val = _mm_set1_pd(valor_item);
+    for (; v + 1 <= V; v += 2) {
+        __m128d nao_levar = _mm_loadu_pd(linha_ant + v);
+        __m128d levar = _mm_add_pd(_mm_loadu_pd(linha_levar + v - vol_item), val);
+        _mm_storeu_pd(linha + v, _mm_max_pd(nao_levar, levar));
+        if (bits) {
+            unsigned m = (unsigned)_mm_movemask_pd(_mm_cmpgt_pd(levar, nao_levar));
+            if (m) ligar_bits(bits, v, m, 2);
+        }
+    }
+    for (; v <= V; v++) {
+        double nao_levar = linha_ant[v];
+        double levar = linha_levar[v - vol_item] + valor_item;
+        linha[v] = max_val(nao_levar, levar);
+        if (bits && levar > nao_levar) bits[v >> 6] |= 1ULL << (v & 63);
+    }
+}
+
+// Centavos em int32: 8 colunas por vetor, o dobro de lanes do double
+__attribute__((target("avx2")))
+void calcular_linha_i32_avx2(int32_t *linha, const int32_t *linha_ant, const int32_t *linha_levar,
+                             int V, int vol_item, int32_t valor_item, uint64_t *bits) {
+    int v = 0;
+    for (; v <= V && v < vol_item; v++) {
+        linha[v] = linha_ant[v];
+    }
+    __m256i val = _mm256_set1_epi32(valor_item);
+    for (; v + 7 <= V; v += 8) {
+        __m256i nao_levar = _mm256_loadu_si256((const __m256i *)(linha_ant + v));
+        __m256i levar = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(linha_levar + v - vol_item)), val);
+        _mm256_storeu_si256((__m256i *)(linha + v), _mm256_max_epi32(nao_levar, levar));
+        if (bits) {
+            unsigned m = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(levar, nao_levar)));
+            if (m) ligar_bits(bits, v, m, 8);
+        }
+    }
+    for (; v <= V; v++) {
+        int32_t nao_levar = linha_ant[v];
+        int32_t levar = linha_levar[v - vol_item] + valor_item;
+        linha[v] = (nao_levar > levar) ? nao_levar : levar;
+        if (bits && levar > nao_levar) bits[v >> 6] |= 1ULL << (v & 63);
+    }
+}
+
+// Centavos em int64: AVX2 não tem max_epi64, então compara e mistura
+__attribute__((target("avx2")))
+void calcular_linha_i64_avx2(int64_t *linha, const int64_t *linha_ant, const int64_t *linha_levar,
+                             int V, int vol_item, int64_t valor_item, uint64_t *bits) {
+    int v = 0;
+    for (; v <= V && v < vol_item; v++) {
+        linha[v] = linha_ant[v];
+    }
+    __m256i val = _mm256_set1_epi64x(valor_item);
+    for (; v + 3 <= V; v += 4) {
+        __m256i nao_levar = _mm256_loadu_si256((const __m256i *)(linha_ant + v));
+        __m256i levar = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)(linha_levar + v - vol_item)), val);
+        __m256i maior = _mm256_cmpgt_epi64(levar, nao_levar);
+        _mm256_storeu_si256((__m256i *)(linha + v), _mm256_blendv_epi8(nao_levar, levar, maior));
+        if (bits) {
+            unsigned m = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(maior));
+            if (m) ligar_bits(bits, v, m, 4);
         }
     }
+    for (; v <= V; v++) {
+        int64_t nao_levar = linha_ant[v];
+        int64_t levar = linha_levar[v - vol_item] + valor_item;
+        linha[v] = (nao_levar > levar) ? nao_levar : levar;
+        if (bits && levar > nao_levar) bits[v >> 6] |= 1ULL << (v & 63);
+    }
+}
+#endif
+
+// Kernels de linha em uso, escolhidos em escolher_kernel() conforme a CPU
+void (*calcular_linha)(double *, const double *, const double *, int, int, double, uint64_t *) = calcular_linha_escalar;
+void (*calcular_linha_i32)(int32_t *, const int32_t *, const int32_t *, int, int, int32_t, uint64_t *) = calcular_linha_i32_escalar;
+void (*calcular_linha_i64)(int64_t *, const int64_t *, const int64_t *, int, int, int64_t, uint64_t *) = calcular_linha_i64_escalar;
+
+// nome: "auto", "avx2", "sse2" ou "escalar". Retorna 0 se o pedido não é suportado.
+int escolher_kernel(const char *nome) {
+    int automatico = strcmp(nome, "auto") == 0;
+    calcular_linha_i32 = calcular_linha_i32_escalar;
+    calcular_linha_i64 = calcular_linha_i64_escalar;
+    if (strcmp(nome, "escalar") == 0) {
+        calcular_linha = calcular_linha_escalar;
+        return 1;
+    }
+#ifdef TEM_SIMD_X86
+    __builtin_cpu_init();
+    if ((automatico || strcmp(nome, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        calcular_linha = calcular_linha_avx2;
+        calcular_linha_i32 = calcular_linha_i32_avx2;
+        calcular_linha_i64 = calcular_linha_i64_avx2;
+        return 1;
+    }
+    if ((automatico || strcmp(nome, "sse2") == 0) && __builtin_cpu_supports("sse2")) {
+        calcular_linha = calcular_linha_sse2;
+        return 1;
+    }
+#endif
+    calcular_linha = calcular_linha_escalar;
+    return automatico;
+}
+
+// Compara a mesma célula em duas camadas (backtracking da tabela completa)
+int celulas_diferentes(const char *a, const char *b, int tipo) {
+    if (tipo == CEL_DOUBLE) return *(const double *)a != *(const double *)b;
+    if (tipo == CEL_I32) return *(const int32_t *)a != *(const int32_t *)b;
+    return *(const int64_t *)a != *(const int64_t *)b;
+}
+
+// Um item que não cabe sozinho no veículo ou que não tem valor positivo nunca é
+// escolhido (levar nunca supera não levar), e a camada dele seria cópia da anterior
+int item_util(const Item *item, int W, int V) {
+    if (item->peso > W || item->volume > V) return 0;
+    return (modo_valor == VALOR_CENTAVOS) ? item->centavos > 0 : item->valor > 0;
+}
+
+// Folga fixa para comparar somas de valores (abaixo de um centavo): só cobre o
+// erro de arredondamento do double, então uma carga um centavo melhor nunca é
+// descartada, por maior que seja o valor total
+double tolerancia_valor() {
+    return (modo_valor == VALOR_CENTAVOS) ? 1e-6 : 0.005;
+}
+
+// ==================== MOTOR DP DENSO ====================
+
+// Disposição da tabela para n itens numa caixa W x V com células de 'tam' bytes
+typedef struct {
+    size_t lin;       // Células por linha (V+1 completado até 64 bytes)
+    size_t bytes_lin;
+    size_t camada;    // Bytes por camada
+    int compacto;
+    size_t camadas;
+    size_t palavras;  // Palavras de 64 bits de decisão por linha (modo compacto)
+    size_t bits_item;
+    size_t bytes;     // Tudo o que motor_dp pede à arena
+} LayoutDP;
+
+LayoutDP planejar_dp(int n, int W, int V, size_t tam) {
+    LayoutDP L;
+    size_t por_cache = 64 / tam;
+    L.lin = ((size_t)V + por_cache) & ~(por_cache - 1);
+    L.bytes_lin = L.lin * tam;
+    L.camada = (size_t)(W + 1) * L.bytes_lin;
+    L.compacto = (modo_dp == DP_COMPACTA) ||
+                 (modo_dp == DP_AUTO && (double)(n + 1) * L.camada > LIMITE_DP_COMPLETA);
+    L.camadas = L.compacto ? 2 : (size_t)n + 1;
+    L.palavras = ((size_t)V + 1 + 63) >> 6;
+    L.bits_item = (size_t)(W + 1) * L.palavras;
+    L.bytes = L.camadas * L.camada + 2 * ((n + 1) * sizeof(int) + 64);
+    if (L.compacto) L.bytes += ((size_t)n * L.bits_item + 1) * sizeof(uint64_t) + 64;
+    return L;
+}
+
+// Mochila 3D sobre a tabela (W+1) x (V+1). Preenche 'escolhidos' com os índices
+// reais dos itens levados na ordem do backtracking (decrescente) e retorna quantos.
+int motor_dp(Veiculo caminhao, const Item *itens, const int *indices_map, int n, int *escolhidos,
+             Arena *arena) {
+    int W = caminhao.cap_peso;
+    int V = caminhao.cap_volume;
+
+    // Limites da camada i: soma dos pesos/volumes dos itens 1..i (até W/V).
+    // Com capacidade acima disso sobra espaço, então dp[i][w][v] ==
+    // dp[i][min(w, lim_w[i])][min(v, lim_v[i])] e só esse retângulo é calculado.
+    int *lim_w = (int *)arena_alocar(arena, (n + 1) * sizeof(int));
+    int *lim_v = (int *)arena_alocar(arena, (n + 1) * sizeof(int));
+    lim_w[0] = lim_v[0] = 0;
+    for (int i = 1; i <= n; i++) {
+        const Item *it = &itens[indices_map[i - 1]];
+        lim_w[i] = (lim_w[i - 1] + it->peso < W) ? lim_w[i - 1] + it->peso : W;
+        lim_v[i] = (lim_v[i - 1] + it->volume < V) ? lim_v[i - 1] + it->volume : V;
+    }
+
+    // Tipo da célula: double, ou centavos em int32 se a soma de todos os
+    // itens disponíveis cabe (nenhuma célula passa dessa soma), senão int64
+    int tipo = CEL_DOUBLE;
+    if (modo_valor == VALOR_CENTAVOS) {
+        int64_t soma = 0;
+        for (int i = 0; i < n; i++) soma += itens[indices_map[i]].centavos;
+        tipo = (soma <= INT32_MAX) ? CEL_I32 : CEL_I64;
+    }
+    size_t tam = (tipo == CEL_I32) ? sizeof(int32_t) : sizeof(int64_t);
+
+    // 1. Tabela DP (n+1) x (W+1) x (V+1) num único bloco contíguo e alinhado.
+    //    Cada linha de volume é completada até múltiplo de 64 bytes, então
+    //    toda linha começa alinhada e o laço em v é sequencial.
+    //    No modo compacto só existem 2 camadas (alternadas) e a decisão de cada
+    //    célula fica num bitset n x (W+1) x palavras, ~64x menos memória.
+    //    As linhas de decisão são zeradas na hora em que a linha é calculada.
+    LayoutDP L = planejar_dp(n, W, V, tam);
+    size_t bytes_lin = L.bytes_lin;
+    size_t camada = L.camada;
+    int compacto = L.compacto;
+    size_t palavras = L.palavras;
+    size_t bits_item = L.bits_item;
+    char *dp = (char *)arena_alocar(arena, L.camadas * camada);
+    uint64_t *decisao = compacto
+        ? (uint64_t *)arena_alocar(arena, ((size_t)n * bits_item + 1) * sizeof(uint64_t))
+        : NULL;
+    memset(dp, 0, camada); // Só a camada 0 precisa nascer zerada
 
     // 2. Preenchimento da Tabela (Programação Dinâmica)
+    //    As células de uma camada só dependem da camada anterior, então as
+    //    linhas de peso são divididas em blocos entre as threads. A equipe é
+    //    criada uma vez e o 'omp for' de cada camada termina numa barreira.
+    //    Cada linha tem suas próprias palavras no bitset, sem disputa entre threads.
+    int paralelo = (size_t)(W + 1) * (V + 1) >= MIN_CELULAS_PARALELO;
+    int linhas_bloco = (int)(BYTES_BLOCO_LINHAS / (3 * bytes_lin));
+    if (linhas_bloco < 1) linhas_bloco = 1;
+#ifdef _OPENMP
+    #pragma omp parallel if(paralelo)
+#else
+    (void)paralelo;
+#endif
     for (int i = 1; i <= n; i++) {
         int idx_real = indices_map[i - 1];
         int peso_item = itens[idx_real].peso;
         int vol_item = itens[idx_real].volume;
-        double valor_item = itens[idx_real].valor;
+        size_t c_ant = compacto ? (size_t)((i - 1) & 1) : (size_t)(i - 1);
+        size_t c_atual = compacto ? (size_t)(i & 1) : (size_t)i;
+        const char *ant = dp + c_ant * camada;
+        char *atual = dp + c_atual * camada;
+        uint64_t *bits = compacto ? decisao + (size_t)(i - 1) * bits_item : NULL;
+        int lw_ant = lim_w[i - 1], lv_ant = lim_v[i - 1];
+        int lw = lim_w[i], lv = lim_v[i];
 
-        for (int w = 0; w <= W; w++) {
-            for (int v = 0; v <= V; v++) {
-                if (peso_item > w || vol_item > v) {
-                    dp[i][w][v] = dp[i - 1][w][v];
-                } else {
-                    double nao_levar = dp[i - 1][w][v];
-                    double levar = dp[i - 1][w - peso_item][v - vol_item] + valor_item;
-                    dp[i][w][v] = max_val(nao_levar, levar);
-                }
+        // Estende as linhas da camada anterior até a coluna lv repetindo o
+        // valor da coluna lv_ant (que é o valor verdadeiro dessas células)
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int w = 0; w <= lw_ant; w++) {
+            char *linha_ant = dp + c_ant * camada + (size_t)w * bytes_lin;
+            for (int v = lv_ant + 1; v <= lv; v++) {
+                memcpy(linha_ant + (size_t)v * tam, linha_ant + (size_t)lv_ant * tam, tam);
+            }
+        }
+
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic, linhas_bloco)
+#endif
+        for (int w = 0; w <= lw; w++) {
+            // Linhas acima de lw_ant na camada anterior são iguais à linha lw_ant
+            const char *linha_ant = ant + (size_t)(w < lw_ant ? w : lw_ant) * bytes_lin;
+            char *linha = atual + (size_t)w * bytes_lin;
+            uint64_t *b = bits ? bits + (size_t)w * palavras : NULL;
+            if (b) memset(b, 0, palavras * sizeof(uint64_t));
+            if (peso_item > w) {
+                memcpy(linha, linha_ant, (lv + 1) * tam);
+                continue;
+            }
+            int w_levar = w - peso_item;
+            const char *linha_levar = ant + (size_t)(w_levar < lw_ant ? w_levar : lw_ant) * bytes_lin;
+            if (tipo == CEL_DOUBLE) {
+                calcular_linha((double *)linha, (const double *)linha_ant, (const double *)linha_levar,
+                               lv, vol_item, itens[idx_real].valor, b);
+            } else if (tipo == CEL_I32) {
+                calcular_linha_i32((int32_t *)linha, (const int32_t *)linha_ant, (const int32_t *)linha_levar,
+                                   lv, vol_item, (int32_t)itens[idx_real].centavos, b);
+            } else {
+                calcular_linha_i64((int64_t *)linha, (const int64_t *)linha_ant, (const int64_t *)linha_levar,
+                                   lv, vol_item, itens[idx_real].centavos, b);
             }
         }
     }
 
     // 3. Backtracking (Recuperar quais itens foram escolhidos)
     // Armazena na ordem inversa (do último item do input para o primeiro)
-    int *itens_escolhidos_idx = (int *)malloc(n * sizeof(int));
     int qtd_escolhidos = 0;
-    
-    double valor_total = 0;
-    int peso_total = 0;
-    int vol_total = 0;
-    
     int w_atual = W;
     int v_atual = V;
 
     for (int i = n; i > 0; i--) {
-        if (dp[i][w_atual][v_atual] != dp[i - 1][w_atual][v_atual]) {
+        // Cada camada só foi calculada dentro do seu retângulo de limites
+        int w = (w_atual < lim_w[i]) ? w_atual : lim_w[i];
+        int v = (v_atual < lim_v[i]) ? v_atual : lim_v[i];
+        int levou;
+        if (compacto) {
+            const uint64_t *bits = decisao + (size_t)(i - 1) * bits_item + (size_t)w * palavras;
+            levou = (bits[v >> 6] >> (v & 63)) & 1;
+        } else {
+            int w_ant = (w_atual < lim_w[i - 1]) ? w_atual : lim_w[i - 1];
+            int v_ant = (v_atual < lim_v[i - 1]) ? v_atual : lim_v[i - 1];
+            levou = celulas_diferentes(dp + (size_t)i * camada + (size_t)w * bytes_lin + (size_t)v * tam,
+                                       dp + (size_t)(i - 1) * camada + (size_t)w_ant * bytes_lin + (size_t)v_ant * tam,
+                                       tipo);
+        }
+        if (levou) {
+            int idx_real = indices_map[i - 1];
+            escolhidos[qtd_escolhidos++] = idx_real;
+            w_atual -= itens[idx_real].peso;
+            v_atual -= itens[idx_real].volume;
+        }
+    }
+
+    return qtd_escolhidos;
+}
+
+// ==================== MOTOR PARETO (ESPARSO) ====================
+// Para capacidades grandes: em vez da tabela W x V guarda, por item, só os
+// estados (peso, volume, valor) não dominados. dp[i][w][v] é o maior valor entre
+// os estados da fronteira i que cabem em (w, v). O valor de cada estado é somado
+// na ordem dos itens, igual à DP, então as comparações do backtracking batem
+// bit a bit e os itens escolhidos são os mesmos.
+
+typedef struct {
+    int peso;
+    int volume;
+    double valor; // No modo centavos guarda centavos (inteiro exato em double)
+} Estado;
+
+// Maior valor da fronteira que cabe em (w, v). Sempre existe o estado vazio.
+double melhor_na_caixa(const Estado *f, int k, int w, int v) {
+    double melhor = 0;
+    for (int j = 0; j < k; j++) {
+        if (f[j].peso <= w && f[j].volume <= v && f[j].valor > melhor) melhor = f[j].valor;
+    }
+    return melhor;
+}
+
+// Ordem (peso crescente, volume crescente, valor decrescente)
+int estado_antes(const Estado *a, const Estado *b) {
+    if (a->peso != b->peso) return a->peso < b->peso;
+    if (a->volume != b->volume) return a->volume < b->volume;
+    return a->valor > b->valor;
+}
+
+// Retorna -1 se a fronteira passar de 'max_estados' (o chamador usa outro motor).
+// Se 'bytes_pico' não for NULL, recebe a memória de trabalho máxima usada.
+int motor_pareto(Veiculo caminhao, const Item *itens, const int *indices_map, int n, int *escolhidos,
+                 size_t max_estados, size_t *bytes_pico) {
+    int W = caminhao.cap_peso;
+    int V = caminhao.cap_volume;
+
+    // Fronteiras de todos os itens num vetor só: a do item i em [ini[i], ini[i + 1])
+    size_t cap = 1024, total = 1;
+    Estado *est = (Estado *)malloc(cap * sizeof(Estado));
+    size_t *ini = (size_t *)malloc((n + 2) * sizeof(size_t));
+    Estado *cand = NULL;
+    size_t cap_cand = 0;
+    // Árvore de Fenwick de máximo por volume: maior valor já mantido com volume <= v
+    double *fen = (double *)malloc((V + 2) * sizeof(double));
+    for (int v = 0; v <= V + 1; v++) fen[v] = -1;
+
+    est[0].peso = est[0].volume = 0;
+    est[0].valor = 0;
+    ini[0] = 0;
+    ini[1] = 1;
+
+    for (int i = 1; i <= n; i++) {
+        const Item *it = &itens[indices_map[i - 1]];
+        double val = (modo_valor == VALOR_CENTAVOS) ? (double)it->centavos : it->valor;
+        const Estado *ant = est + ini[i - 1];
+        size_t k = ini[i] - ini[i - 1];
+
+        // Intercala a fronteira anterior com ela deslocada pelo item (ambas ordenadas)
+        if (cap_cand < 2 * k) {
+            cap_cand = 2 * k;
+            cand = (Estado *)realloc(cand, cap_cand * sizeof(Estado));
+        }
+        size_t a = 0, b = 0, m = 0;
+        while (a < k || b < k) {
+            Estado novo;
+            int tem_novo = 0;
+            if (b < k) {
+                novo.peso = ant[b].peso + it->peso;
+                novo.volume = ant[b].volume + it->volume;
+                novo.valor = ant[b].valor + val;
+                tem_novo = 1;
+                if (novo.peso > W || novo.volume > V) {
+                    b++;
+                    continue;
+                }
+            }
+            if (a < k && (!tem_novo || !estado_antes(&novo, &ant[a]))) cand[m++] = ant[a++];
+            else {
+                cand[m++] = novo;
+                b++;
+            }
+        }
+
+        // Poda: na ordem acima, um estado é dominado se algum já mantido tem
+        // volume <= o dele e valor >= o dele (o peso já é <= pela ordenação)
+        if (total + m > cap) {
+            while (total + m > cap) cap *= 2;
+            est = (Estado *)realloc(est, cap * sizeof(Estado));
+        }
+        size_t mantidos = 0;
+        for (size_t j = 0; j < m; j++) {
+            double melhor = -1;
+            for (int x = cand[j].volume + 1; x > 0; x -= x & -x) {
+                if (fen[x] > melhor) melhor = fen[x];
+            }
+            if (melhor >= cand[j].valor) continue;
+            est[total + mantidos++] = cand[j];
+            for (int x = cand[j].volume + 1; x <= V + 1; x += x & -x) {
+                if (cand[j].valor > fen[x]) fen[x] = cand[j].valor;
+            }
+        }
+        // Zera só as posições tocadas
+        for (size_t j = 0; j < mantidos; j++) {
+            for (int x = est[total + j].volume + 1; x <= V + 1; x += x & -x) fen[x] = -1;
+        }
+        total += mantidos;
+        ini[i + 1] = total;
+
+        if (bytes_pico) {
+            *bytes_pico = (cap + cap_cand) * sizeof(Estado) + (V + 2) * sizeof(double) + (n + 2) * sizeof(size_t);
+        }
+        if (total > max_estados) {
+            free(est);
+            free(ini);
+            free(cand);
+            free(fen);
+            return -1;
+        }
+    }
+
+    // Backtracking: mesmo critério da tabela, dp[i][w][v] != dp[i-1][w][v]
+    int qtd_escolhidos = 0;
+    int w_atual = W;
+    int v_atual = V;
+    for (int i = n; i > 0; i--) {
+        double com = melhor_na_caixa(est + ini[i], (int)(ini[i + 1] - ini[i]), w_atual, v_atual);
+        double sem = melhor_na_caixa(est + ini[i - 1], (int)(ini[i] - ini[i - 1]), w_atual, v_atual);
+        if (com != sem) {
             int idx_real = indices_map[i - 1];
-            
-            itens[idx_real].carregado = 1; // Marca como usado
-            itens_escolhidos_idx[qtd_escolhidos++] = idx_real;
-            
-            valor_total += itens[idx_real].valor;
-            peso_total += itens[idx_real].peso;
-            vol_total += itens[idx_real].volume;
-            
+            escolhidos[qtd_escolhidos++] = idx_real;
             w_atual -= itens[idx_real].peso;
             v_atual -= itens[idx_real].volume;
         }
     }
 
-    // 4. Escrita no arquivo de saída
-    fprintf(saida, "[%s]R$%.2f,", caminhao.placa, valor_total);
+    free(est);
+    free(ini);
+    free(cand);
+    free(fen);
+    return qtd_escolhidos;
+}
+
+// ==================== MOTOR BRANCH-AND-BOUND ====================
+// Para veículos em que nem a tabela nem a fronteira cabem. Os itens são
+// percorridos em ordem de densidade valor / (peso/W + volume/V) e o limite
+// superior de cada nó é a mochila fracionária sobre essa restrição substituta
+// (soma das duas restrições normalizadas), ignorando itens que não cabem sozinhos
+// no espaço que sobra. O valor ótimo é o mesmo da DP, mas em empates a carga
+// escolhida pode ser outra. Com orçamento de tempo devolve a melhor carga achada
+// e o maior limite ainda aberto, que prova o quanto ela pode estar longe do ótimo
+// (aviso no stderr, para não se misturar ao relatório do lote).
+
+double agora() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    int n;
+    int *idx;             // Índice real do item, em ordem de densidade
+    int *peso;
+    int *volume;
+    double *valor;
+    double *custo;        // peso/W + volume/V
+    char *atual;          // Decisões do ramo atual
+    char *melhor_sel;     // Melhor carga achada
+    double melhor;
+    double tolerancia;    // tolerancia_valor(), lida uma vez por busca
+    double limite_aberto; // Maior limite entre os nós não explorados (se interrompido)
+    double prazo;         // agora() limite; 0 = sem orçamento
+    long nos;
+    int interrompido;
+} BB;
+
+typedef struct {
+    double densidade;
+    int pos;
+} Densidade;
+
+int comparar_densidade(const void *a, const void *b) {
+    const Densidade *x = (const Densidade *)a, *y = (const Densidade *)b;
+    if (x->densidade != y->densidade) return (x->densidade > y->densidade) ? -1 : 1;
+    return x->pos - y->pos;
+}
+
+int comparar_desc(const void *a, const void *b) {
+    return *(const int *)b - *(const int *)a;
+}
+
+// Limite superior para o nó: valor + mochila fracionária dos itens d..n-1
+double bb_limite(const BB *bb, int d, int w_livre, int v_livre, double valor, double cap) {
+    for (int j = d; j < bb->n; j++) {
+        if (bb->peso[j] > w_livre || bb->volume[j] > v_livre) continue;
+        if (bb->custo[j] <= cap) {
+            cap -= bb->custo[j];
+            valor += bb->valor[j];
+        } else {
+            return valor + bb->valor[j] * (cap / bb->custo[j]);
+        }
+    }
+    return valor;
+}
+
+void bb_ramo(BB *bb, int d, int w_livre, int v_livre, double valor, double cap) {
+    // Depois de interrompido, cada nó que ainda seria visitado só registra o limite
+    if (bb->interrompido) {
+        double lim = bb_limite(bb, d, w_livre, v_livre, valor, cap);
+        if (lim > bb->limite_aberto) bb->limite_aberto = lim;
+        return;
+    }
+    if (valor > bb->melhor) {
+        bb->melhor = valor;
+        memcpy(bb->melhor_sel, bb->atual, d);
+        memset(bb->melhor_sel + d, 0, bb->n - d);
+    }
+    if (d == bb->n) return;
+
+    double lim = bb_limite(bb, d, w_livre, v_livre, valor, cap);
+    if (lim <= bb->melhor + bb->tolerancia) return;
+    if (bb->prazo > 0 && (++bb->nos & 4095) == 0 && agora() > bb->prazo) {
+        bb->interrompido = 1;
+        if (lim > bb->limite_aberto) bb->limite_aberto = lim;
+        return;
+    }
+
+    if (bb->peso[d] <= w_livre && bb->volume[d] <= v_livre) {
+        bb->atual[d] = 1;
+        bb_ramo(bb, d + 1, w_livre - bb->peso[d], v_livre - bb->volume[d], valor + bb->valor[d],
+                cap - bb->custo[d]);
+    }
+    bb->atual[d] = 0;
+    bb_ramo(bb, d + 1, w_livre, v_livre, valor, cap);
+}
+
+int motor_bb(Veiculo caminhao, const Item *itens, const int *indices_map, int n, int *escolhidos) {
+    int W = caminhao.cap_peso;
+    int V = caminhao.cap_volume;
+    BB bb;
+    bb.n = n;
+    bb.idx = (int *)malloc((n + 1) * sizeof(int));
+    bb.peso = (int *)malloc((n + 1) * sizeof(int));
+    bb.volume = (int *)malloc((n + 1) * sizeof(int));
+    bb.valor = (double *)malloc((n + 1) * sizeof(double));
+    bb.custo = (double *)malloc((n + 1) * sizeof(double));
+    bb.atual = (char *)calloc(n + 1, 1);
+    bb.melhor_sel = (char *)calloc(n + 1, 1);
+
+    // Ordena por densidade (custo zero vai na frente: sempre cabe)
+    Densidade *dens = (Densidade *)malloc((n + 1) * sizeof(Densidade));
+    for (int i = 0; i < n; i++) {
+        const Item *it = &itens[indices_map[i]];
+        double val = (modo_valor == VALOR_CENTAVOS) ? (double)it->centavos : it->valor;
+        double custo = (W > 0 ? (double)it->peso / W : 0) + (V > 0 ? (double)it->volume / V : 0);
+        dens[i].densidade = (custo > 0) ? val / custo : HUGE_VAL;
+        dens[i].pos = i;
+    }
+    qsort(dens, n, sizeof(Densidade), comparar_densidade);
+    for (int j = 0; j < n; j++) {
+        const Item *it = &itens[indices_map[dens[j].pos]];
+        bb.idx[j] = indices_map[dens[j].pos];
+        bb.peso[j] = it->peso;
+        bb.volume[j] = it->volume;
+        bb.valor[j] = (modo_valor == VALOR_CENTAVOS) ? (double)it->centavos : it->valor;
+        bb.custo[j] = (W > 0 ? (double)it->peso / W : 0) + (V > 0 ? (double)it->volume / V : 0);
+    }
+    free(dens);
+
+    // Solução inicial gulosa na mesma ordem
+    int w_livre = W, v_livre = V;
+    bb.melhor = 0;
+    bb.tolerancia = tolerancia_valor();
+    for (int j = 0; j < n; j++) {
+        if (bb.peso[j] <= w_livre && bb.volume[j] <= v_livre) {
+            bb.melhor_sel[j] = 1;
+            bb.melhor += bb.valor[j];
+            w_livre -= bb.peso[j];
+            v_livre -= bb.volume[j];
+        }
+    }
+
+    bb.limite_aberto = 0;
+    double orcamento = (tempo_bb >= 0) ? tempo_bb : (motor == MOTOR_AUTO ? TEMPO_BB_PADRAO : 0);
+    bb.prazo = (orcamento > 0) ? agora() + orcamento : 0;
+    bb.nos = 0;
+    bb.interrompido = 0;
+    bb_ramo(&bb, 0, W, V, 0, (W > 0) + (V > 0));
+
+    if (bb.interrompido && bb.limite_aberto > bb.melhor) {
+        double escala = (modo_valor == VALOR_CENTAVOS) ? 100.0 : 1.0;
+        fprintf(stderr, "[%s] Tempo do branch-and-bound esgotado: carga R$%.2f, limite R$%.2f (gap %.2f%%)\n",
+                caminhao.placa, bb.melhor / escala, bb.limite_aberto / escala,
+                100.0 * (bb.limite_aberto - bb.melhor) / bb.limite_aberto);
+    }
+
+    // Mesma ordem de impressão dos outros motores: índice real decrescente
+    int qtd_escolhidos = 0;
+    for (int j = 0; j < n; j++) {
+        if (bb.melhor_sel[j]) escolhidos[qtd_escolhidos++] = bb.idx[j];
+    }
+    qsort(escolhidos, qtd_escolhidos, sizeof(int), comparar_desc);
+
+    free(bb.idx);
+    free(bb.peso);
+    free(bb.volume);
+    free(bb.valor);
+    free(bb.custo);
+    free(bb.atual);
+    free(bb.melhor_sel);
+    return qtd_escolhidos;
+}
+
+// ==================== CARREGAMENTO DO VEÍCULO ====================
+
+// Escolhe a carga ótima do veículo entre os itens ainda não carregados, sem
+// marcá-los. *escolhidos aponta para a arena (vale até o próximo reinício),
+// em ordem decrescente de índice; retorna quantos são.
+int escolher_carga(Veiculo caminhao, Item *itens, int qtd_itens, Arena *arena, int **escolhidos) {
+    int W = caminhao.cap_peso;
+    int V = caminhao.cap_volume;
+    
+    // Mapear apenas itens ainda não carregados (e que podem ser escolhidos)
+    int itens_disponiveis = 0;
+    arena_reiniciar(arena);
+    int *indices_map = (int *)arena_alocar(arena, (qtd_itens + 1) * sizeof(int));
+    
+    for (int i = 0; i < qtd_itens; i++) {
+        if (!itens[i].carregado && item_util(&itens[i], W, V)) {
+            indices_map[itens_disponiveis] = i;
+            itens_disponiveis++;
+        }
+    }
+
+    int n = itens_disponiveis;
+    int *itens_escolhidos_idx = (int *)arena_alocar(arena, (n + 1) * sizeof(int));
+
+    // Tabela densa enquanto W x V é pequeno; acima disso, fronteira de Pareto.
+    // Se ela também explodir, volta para a tabela no modo compacto, ou para o
+    // branch-and-bound quando nem a tabela compacta cabe na memória.
+    int qtd_escolhidos = -1;
+    if (motor == MOTOR_BB) {
+        qtd_escolhidos = motor_bb(caminhao, itens, indices_map, n, itens_escolhidos_idx);
+    }
+    int usar_pareto = (motor == MOTOR_PARETO) ||
+                      (motor == MOTOR_AUTO && (double)(W + 1) * (V + 1) > LIMITE_CELULAS_DENSA);
+    if (usar_pareto && qtd_escolhidos < 0) {
+        double max_estados = (double)n * (W + 1) * (V + 1) / CUSTO_ESTADO_EM_CELULAS;
+        if (motor == MOTOR_PARETO || max_estados > LIMITE_ESTADOS_PARETO) max_estados = LIMITE_ESTADOS_PARETO;
+        qtd_escolhidos = motor_pareto(caminhao, itens, indices_map, n, itens_escolhidos_idx,
+                                      (size_t)max_estados + 1, NULL);
+    }
+    if (qtd_escolhidos < 0 && motor == MOTOR_AUTO) {
+        double bytes_compacta = (double)n * (W + 1) * (((double)V + 64) / 8) + 2.0 * (W + 1) * (V + 8) * 8;
+        if (bytes_compacta > LIMITE_DP_COMPACTA) {
+            qtd_escolhidos = motor_bb(caminhao, itens, indices_map, n, itens_escolhidos_idx);
+        }
+    }
+    if (qtd_escolhidos < 0) {
+        qtd_escolhidos = motor_dp(caminhao, itens, indices_map, n, itens_escolhidos_idx, arena);
+    }
+    *escolhidos = itens_escolhidos_idx;
+    return qtd_escolhidos;
+}
+
+// Escreve a linha do veículo: [placa]R$valor,pesoKG(p%),volL(v%)->itens
+void escrever_carga(Veiculo caminhao, const Item *itens, const int *itens_escolhidos_idx, int qtd_escolhidos,
+                    Escritor *saida) {
+    double valor_total = 0;
+    int64_t centavos_total = 0;
+    int peso_total = 0;
+    int vol_total = 0;
+    for (int i = 0; i < qtd_escolhidos; i++) {
+        const Item *it = &itens[itens_escolhidos_idx[i]];
+        valor_total += it->valor;
+        centavos_total += it->centavos;
+        peso_total += it->peso;
+        vol_total += it->volume;
+    }
+
+    if (modo_valor == VALOR_CENTAVOS) valor_total = centavos_total / 100.0;
+    esc_char(saida, '[');
+    esc_txt(saida, caminhao.placa);
+    esc_txt(saida, "]R$");
+    esc_real2(saida, valor_total);
+    esc_char(saida, ',');
     
     int perc_peso = (caminhao.cap_peso > 0) ? (int)round(((double)peso_total / caminhao.cap_peso) * 100) : 0;
     int perc_vol = (caminhao.cap_volume > 0) ? (int)round(((double)vol_total / caminhao.cap_volume) * 100) : 0;
     
-    fprintf(saida, "%dKG(%d%%),%dL(%d%%)->", peso_total, perc_peso, vol_total, perc_vol);
+    esc_int(saida, peso_total);
+    esc_txt(saida, "KG(");
+    esc_int(saida, perc_peso);
+    esc_txt(saida, "%),");
+    esc_int(saida, vol_total);
+    esc_txt(saida, "L(");
+    esc_int(saida, perc_vol);
+    esc_txt(saida, "%)->");
 
     // --- CORREÇÃO: Ordem de Impressão ---
     // O arquivo saida.txt lista os itens na ordem do backtracking (Decrescente de índice original).
     // Antes estava invertendo para (Crescente), o que gerava a diferença.
     for (int i = 0; i < qtd_escolhidos; i++) {
-        fprintf(saida, "%s", itens[itens_escolhidos_idx[i]].codigo);
+        esc_txt(saida, itens[itens_escolhidos_idx[i]].codigo);
         if (i < qtd_escolhidos - 1) {
-            fprintf(saida, ",");
+            esc_char(saida, ',');
         }
     }
-    fprintf(saida, "\n");
+    esc_char(saida, '\n');
+}
 
-    // 5. Limpeza de memória local
-    liberar_matriz(dp, n, W);
-    free(indices_map);
-    free(itens_escolhidos_idx);
+// Função principal de otimização (Algoritmo da Mochila 3D)
+void processar_carga(Veiculo caminhao, Item *itens, int qtd_itens, Escritor *saida, Arena *arena) {
+    int *escolhidos;
+    int qtd = escolher_carga(caminhao, itens, qtd_itens, arena, &escolhidos);
+    for (int i = 0; i < qtd; i++) {
+        itens[escolhidos[i]].carregado = 1; // Marca como usado
+    }
+    escrever_carga(caminhao, itens, escolhidos, qtd, saida);
+    // A memória local fica na arena, esvaziada no próximo veículo
 }
 
-int main(int argc, char *argv[]) {
-    // Validação de argumentos para evitar erro se não passar os arquivos
-    if (argc != 3) {
-        printf("Uso: %s <entrada> <saida>\n", argv[0]);
+// ==================== ALOCAÇÃO GLOBAL DA FROTA ====================
+// O modo padrão enche os veículos na ordem do arquivo, e o primeiro pega os
+// melhores itens mesmo quando um veículo seguinte aproveitaria melhor o conjunto.
+// Aqui (--frota global) cada veículo continua sendo resolvido de forma exata,
+// mas a divisão dos itens entre eles é melhorada:
+//   1. Duas soluções iniciais: a ordem do arquivo (a do modo padrão) e os
+//      veículos em ordem decrescente de capacidade. Fica a de maior valor.
+//   2. Busca local por pares: para cada par (a, b), os itens de a, de b e os
+//      pendentes voltam para o bolo e o par é recarregado nas duas ordens
+//      (a depois b, b depois a). A troca só é aceita se o valor do par subir,
+//      então o total entregue nunca cai abaixo do modo padrão.
+// As passadas se repetem até nenhum par melhorar ou o tempo acabar
+// (--tempo-frota, padrão TEMPO_FROTA_PADRAO s). O tempo é conferido entre duas
+// recargas, então pode passar do limite no máximo pelo tempo de uma recarga.
+
+#define TEMPO_FROTA_PADRAO 10.0
+
+#define FROTA_SEQUENCIAL 0
+#define FROTA_GLOBAL 1
+
+int modo_frota = FROTA_SEQUENCIAL;
+double tempo_frota = TEMPO_FROTA_PADRAO;
+
+static inline double valor_item(const Item *it) {
+    return (modo_valor == VALOR_CENTAVOS) ? (double)it->centavos : it->valor;
+}
+
+// Carrega os veículos 'ordem[0..k-1]' em sequência entre os itens livres
+// (carregado == 0), marcando dono[] e carregado[]. Retorna o valor somado.
+double carregar_em_ordem(const Veiculo *frota, const int *ordem, int k, Item *itens, int qtd_itens,
+                         int *dono, Arena *arena) {
+    double total = 0;
+    for (int j = 0; j < k; j++) {
+        int *escolhidos;
+        int qtd = escolher_carga(frota[ordem[j]], itens, qtd_itens, arena, &escolhidos);
+        for (int i = 0; i < qtd; i++) {
+            itens[escolhidos[i]].carregado = 1;
+            dono[escolhidos[i]] = ordem[j];
+            total += valor_item(&itens[escolhidos[i]]);
+        }
+    }
+    return total;
+}
+
+// Preenche dono[] (veículo de cada item, -1 = pendente) e deixa carregado[] coerente
+void alocar_frota(const Veiculo *frota, int qtd_veiculos, Item *itens, int qtd_itens, int *dono, Arena *arena) {
+    double prazo = agora() + tempo_frota;
+    int *ordem = (int *)calloc(qtd_veiculos + 1, sizeof(int));
+    int *dono_b = (int *)malloc((qtd_itens + 1) * sizeof(int));
+    double *valor_v = (double *)calloc(qtd_veiculos + 1, sizeof(double));
+
+    // 1a. Ordem do arquivo
+    for (int v = 0; v < qtd_veiculos; v++) ordem[v] = v;
+    for (int i = 0; i < qtd_itens; i++) {
+        itens[i].carregado = 0;
+        dono[i] = -1;
+    }
+    double total = carregar_em_ordem(frota, ordem, qtd_veiculos, itens, qtd_itens, dono, arena);
+
+    // 1b. Maiores primeiro (peso e volume normalizados pelo maior da frota)
+    double max_w = 1, max_v = 1;
+    for (int v = 0; v < qtd_veiculos; v++) {
+        if (frota[v].cap_peso > max_w) max_w = frota[v].cap_peso;
+        if (frota[v].cap_volume > max_v) max_v = frota[v].cap_volume;
+    }
+    Densidade *cap = (Densidade *)malloc((qtd_veiculos + 1) * sizeof(Densidade));
+    for (int v = 0; v < qtd_veiculos; v++) {
+        cap[v].densidade = frota[v].cap_peso / max_w + frota[v].cap_volume / max_v;
+        cap[v].pos = v;
+    }
+    qsort(cap, qtd_veiculos, sizeof(Densidade), comparar_densidade);
+    for (int v = 0; v < qtd_veiculos; v++) ordem[v] = cap[v].pos;
+    free(cap);
+    if (agora() < prazo) {
+        for (int i = 0; i < qtd_itens; i++) {
+            itens[i].carregado = 0;
+            dono_b[i] = -1;
+        }
+        double total_b = carregar_em_ordem(frota, ordem, qtd_veiculos, itens, qtd_itens, dono_b, arena);
+        if (total_b > total) {
+            memcpy(dono, dono_b, qtd_itens * sizeof(int));
+            total = total_b;
+        }
+    }
+
+    // 2. Busca local por pares
+    for (int i = 0; i < qtd_itens; i++) {
+        if (dono[i] >= 0) valor_v[dono[i]] += valor_item(&itens[i]);
+    }
+    int melhorou = 1;
+    while (melhorou && agora() < prazo) {
+        melhorou = 0;
+        for (int a = 0; a < qtd_veiculos && agora() < prazo; a++) {
+            for (int b = a + 1; b < qtd_veiculos && agora() < prazo; b++) {
+                double atual = valor_v[a] + valor_v[b];
+                double melhor = atual;
+                int melhor_ordem = -1;
+                for (int sentido = 0; sentido < 2; sentido++) {
+                    int par[2] = {sentido ? b : a, sentido ? a : b};
+                    for (int i = 0; i < qtd_itens; i++) {
+                        itens[i].carregado = !(dono[i] == -1 || dono[i] == a || dono[i] == b);
+                        dono_b[i] = dono[i];
+                        if (dono_b[i] == a || dono_b[i] == b) dono_b[i] = -1;
+                    }
+                    double v_par = carregar_em_ordem(frota, par, 2, itens, qtd_itens, dono_b, arena);
+                    if (v_par > melhor + tolerancia_valor()) {
+                        melhor = v_par;
+                        melhor_ordem = sentido;
+                    }
+                }
+                if (melhor_ordem < 0) continue;
+
+                // Refaz a melhor ordem para obter as cargas e aplica
+                int par[2] = {melhor_ordem ? b : a, melhor_ordem ? a : b};
+                for (int i = 0; i < qtd_itens; i++) {
+                    itens[i].carregado = !(dono[i] == -1 || dono[i] == a || dono[i] == b);
+                    if (dono[i] == a || dono[i] == b) dono[i] = -1;
+                }
+                carregar_em_ordem(frota, par, 2, itens, qtd_itens, dono, arena);
+                valor_v[a] = valor_v[b] = 0;
+                for (int i = 0; i < qtd_itens; i++) {
+                    if (dono[i] == a || dono[i] == b) valor_v[dono[i]] += valor_item(&itens[i]);
+                }
+                total += melhor - atual;
+                melhorou = 1;
+            }
+        }
+    }
+
+    for (int i = 0; i < qtd_itens; i++) itens[i].carregado = dono[i] >= 0;
+    free(ordem);
+    free(dono_b);
+    free(valor_v);
+}
+
+// ==================== GERADOR E BENCHMARK ====================
+// --gerar escreve um manifesto sintético; --bench resolve um veículo de
+// capacidade crescente com cada motor e mede tempo, células/s e memória.
+// Correlação valor x tamanho:
+//   nenhuma: valor uniforme, independente de peso e volume
+//   forte:   valor = 10 * (peso + volume) + 100 (difícil para a DP e para limites)
+//   soma:    valor = 10 * (peso + volume), todos com a mesma densidade (tipo subset-sum)
+
+#define CORR_NENHUMA 0
+#define CORR_FORTE 1
+#define CORR_SOMA 2
+
+typedef struct {
+    int veiculos;
+    int itens;
+    int cap;           // Capacidade máxima de peso e de volume
+    int corr;          // CORR_*; -1 no bench roda as três
+    uint64_t semente;
+} ParamGerador;
+
+static uint64_t bench_rng;
+
+static inline uint64_t bench_rand() {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 7;
+    bench_rng ^= bench_rng << 17;
+    return bench_rng;
+}
+
+// Veículos com capacidade em [cap/2, cap]; itens com peso e volume em [1, cap/10]
+void gerar_instancia(const ParamGerador *g, Veiculo *frota, Item *itens) {
+    bench_rng = g->semente ? g->semente : 88172645463325252ULL;
+    int meio = g->cap / 2;
+    for (int v = 0; v < g->veiculos; v++) {
+        snprintf(frota[v].placa, sizeof(frota[v].placa), "VEI%04d", v % 10000);
+        frota[v].cap_peso = meio + (int)(bench_rand() % (uint64_t)(g->cap - meio + 1));
+        frota[v].cap_volume = meio + (int)(bench_rand() % (uint64_t)(g->cap - meio + 1));
+    }
+    int max_item = g->cap / 10 > 1 ? g->cap / 10 : 1;
+    for (int i = 0; i < g->itens; i++) {
+        Item *it = &itens[i];
+        snprintf(it->codigo, sizeof(it->codigo), "IT%08d", i);
+        it->peso = 1 + (int)(bench_rand() % (uint64_t)max_item);
+        it->volume = 1 + (int)(bench_rand() % (uint64_t)max_item);
+        if (g->corr == CORR_NENHUMA) it->centavos = 1000 + (int64_t)(bench_rand() % 99001);
+        else if (g->corr == CORR_FORTE) it->centavos = 1000 * (int64_t)(it->peso + it->volume) + 10000;
+        else it->centavos = 1000 * (int64_t)(it->peso + it->volume);
+        it->valor = it->centavos / 100.0;
+        it->carregado = 0;
+    }
+}
+
+int gerar_manifesto(const char *caminho, const ParamGerador *g) {
+    Veiculo *frota = (Veiculo *)malloc((g->veiculos + 1) * sizeof(Veiculo));
+    Item *itens = (Item *)malloc((g->itens + 1) * sizeof(Item));
+    gerar_instancia(g, frota, itens);
+    FILE *f = fopen(caminho, "w");
+    if (!f) {
+        printf("Erro ao criar arquivo: %s\n", caminho);
+        free(frota);
+        free(itens);
         return 1;
     }
+    fprintf(f, "%d\n", g->veiculos);
+    for (int v = 0; v < g->veiculos; v++) {
+        fprintf(f, "%s %d %d\n", frota[v].placa, frota[v].cap_peso, frota[v].cap_volume);
+    }
+    fprintf(f, "%d\n", g->itens);
+    for (int i = 0; i < g->itens; i++) {
+        fprintf(f, "%s %.2f %d %d\n", itens[i].codigo, itens[i].valor, itens[i].peso, itens[i].volume);
+    }
+    fclose(f);
+    free(frota);
+    free(itens);
+    return 0;
+}
+
+double memoria_pico_processo_mb() {
+#ifndef _WIN32
+    struct rusage r;
+    if (getrusage(RUSAGE_SELF, &r) == 0) {
+#ifdef __APPLE__
+        return r.ru_maxrss / 1048576.0;
+#else
+        return r.ru_maxrss / 1024.0;
+#endif
+    }
+#endif
+    return -1;
+}
+
+// Um veículo W = V = cap com todos os itens, para cada motor. A coluna
+// celulas/s usa a tabela nominal n x (W+1) x (V+1), também para os motores
+// esparsos, para dar para comparar; mem_MB é a memória de trabalho do motor.
+void executar_bench(const ParamGerador *base, int cap_max, double tempo_limite) {
+    static const char *corr_nome[] = {"nenhuma", "forte", "soma"};
+    static const char *motor_nome[] = {"dp-completa", "dp-compacta", "pareto", "bb"};
+    int n = base->itens;
+    Item *itens = (Item *)malloc((n + 1) * sizeof(Item));
+    Veiculo veiculo;
+    int *indices_map = (int *)malloc((n + 1) * sizeof(int));
+    int *escolhidos = (int *)malloc((n + 1) * sizeof(int));
+    Arena arena;
+    memset(&arena, 0, sizeof(Arena));
+    int modo_dp_orig = modo_dp;
+    double tempo_bb_orig = tempo_bb;
+
+    printf("%-6s %-6s %-8s %-12s %9s %13s %9s %14s %s\n", "cap", "itens", "corr", "motor", "tempo_s",
+           "celulas/s", "mem_MB", "valor", "");
+    for (int cap = 50; cap <= cap_max; cap *= 2) {
+        for (int c = 0; c < 3; c++) {
+            if (base->corr >= 0 && c != base->corr) continue;
+            ParamGerador g = *base;
+            g.veiculos = 1;
+            g.cap = cap;
+            g.corr = c;
+            Veiculo tmp;
+            gerar_instancia(&g, &tmp, itens);
+            snprintf(veiculo.placa, sizeof(veiculo.placa), "BENCH");
+            veiculo.cap_peso = veiculo.cap_volume = cap;
+            int m = 0;
+            for (int i = 0; i < n; i++) {
+                if (item_util(&itens[i], cap, cap)) indices_map[m++] = i;
+            }
+            double nominal = (double)m * (cap + 1) * (cap + 1);
+            double valor_ref = -1;
+
+            for (int e = 0; e < 4; e++) {
+                size_t bytes = 0;
+                int qtd = -1;
+                double t0 = agora();
+                if (e <= 1) {
+                    modo_dp = (e == 0) ? DP_COMPLETA : DP_COMPACTA;
+                    LayoutDP L = planejar_dp(m, cap, cap, sizeof(double));
+                    if ((double)L.bytes > (e == 0 ? LIMITE_DP_COMPLETA : LIMITE_DP_COMPACTA)) {
+                        printf("%-6d %-6d %-8s %-12s pulado: %.0f MB\n", cap, m, corr_nome[c], motor_nome[e],
+                               L.bytes / 1048576.0);
+                        continue;
+                    }
+                    arena_reiniciar(&arena);
+                    t0 = agora();
+                    qtd = motor_dp(veiculo, itens, indices_map, m, escolhidos, &arena);
+                    bytes = L.bytes;
+                } else if (e == 2) {
+                    qtd = motor_pareto(veiculo, itens, indices_map, m, escolhidos, LIMITE_ESTADOS_PARETO, &bytes);
+                } else {
+                    tempo_bb = tempo_limite;
+                    qtd = motor_bb(veiculo, itens, indices_map, m, escolhidos);
+                    bytes = (size_t)m * (3 * sizeof(int) + 2 * sizeof(double) + 2 + sizeof(Densidade) + 64);
+                }
+                double t = agora() - t0;
+                if (qtd < 0) {
+                    printf("%-6d %-6d %-8s %-12s desistiu: fronteira acima de %u estados (%.3f s)\n", cap, m,
+                           corr_nome[c], motor_nome[e], LIMITE_ESTADOS_PARETO, t);
+                    continue;
+                }
+                double valor = 0;
+                for (int i = 0; i < qtd; i++) valor += itens[escolhidos[i]].valor;
+                if (valor_ref < 0) valor_ref = valor;
+                printf("%-6d %-6d %-8s %-12s %9.4f %13.3e %9.2f %14.2f %s\n", cap, m, corr_nome[c], motor_nome[e],
+                       t, t > 0 ? nominal / t : 0, bytes / 1048576.0, valor,
+                       fabs(valor - valor_ref) < 0.005 ? "" : "(valor diverge)");
+            }
+        }
+    }
+    double rss = memoria_pico_processo_mb();
+    if (rss >= 0) printf("Pico de memoria do processo: %.1f MB\n", rss);
 
-    FILE *entrada = fopen(argv[1], "r");
-    if (!entrada) {
-        printf("Erro ao abrir arquivo de entrada: %s\n", argv[1]);
+    modo_dp = modo_dp_orig;
+    tempo_bb = tempo_bb_orig;
+    arena_liberar(&arena);
+    free(itens);
+    free(indices_map);
+    free(escolhidos);
+}
+
+// ==================== MANIFESTOS ====================
+
+// Resolve um manifesto completo (veículos em ordem, depois os pendentes).
+// Retorna 0 se deu certo; qtd_v/qtd_i (opcionais) recebem os tamanhos lidos.
+int resolver_manifesto(const char *entrada_path, const char *saida_path, int *qtd_v, int *qtd_i) {
+    Leitor entrada;
+    if (!abrir_leitor(&entrada, entrada_path)) {
+        printf("Erro ao abrir arquivo de entrada: %s\n", entrada_path);
         return 1;
     }
 
     int qtd_veiculos;
-    if (fscanf(entrada, "%d", &qtd_veiculos) != 1) return 1;
+    if (!ler_int(&entrada, &qtd_veiculos)) {
+        fechar_leitor(&entrada);
+        return 1;
+    }
 
     Veiculo *frota = (Veiculo *)malloc(qtd_veiculos * sizeof(Veiculo));
     for (int i = 0; i < qtd_veiculos; i++) {
-        fscanf(entrada, "%s %d %d", frota[i].placa, &frota[i].cap_peso, &frota[i].cap_volume);
+        ler_palavra(&entrada, frota[i].placa, sizeof(frota[i].placa));
+        ler_int(&entrada, &frota[i].cap_peso);
+        ler_int(&entrada, &frota[i].cap_volume);
     }
 
     int qtd_itens;
-    if (fscanf(entrada, "%d", &qtd_itens) != 1) return 1;
+    if (!ler_int(&entrada, &qtd_itens)) {
+        fechar_leitor(&entrada);
+        free(frota);
+        return 1;
+    }
 
     Item *itens = (Item *)malloc(qtd_itens * sizeof(Item));
     for (int i = 0; i < qtd_itens; i++) {
-        fscanf(entrada, "%s %lf %d %d", itens[i].codigo, &itens[i].valor, &itens[i].peso, &itens[i].volume);
+        ler_palavra(&entrada, itens[i].codigo, sizeof(itens[i].codigo));
+        ler_decimal(&entrada, &itens[i].valor, &itens[i].centavos);
+        ler_int(&entrada, &itens[i].peso);
+        ler_int(&entrada, &itens[i].volume);
         itens[i].carregado = 0;
     }
-    fclose(entrada);
+    fechar_leitor(&entrada);
 
-    FILE *saida = fopen(argv[2], "w");
-    if (!saida) {
-        printf("Erro ao criar arquivo de saida: %s\n", argv[2]);
+    Escritor saida;
+    saida.f = fopen(saida_path, "w");
+    if (!saida.f) {
+        printf("Erro ao criar arquivo de saida: %s\n", saida_path);
         free(frota);
         free(itens);
         return 1;
     }
+    saida.v = (char *)malloc(TAM_ESCRITOR);
+    saida.n = 0;
 
-    // Processar Veículos
+    // Arena dimensionada uma vez pelo maior veículo que vai pela tabela densa,
+    // com células de 8 bytes. Com todos os itens a tabela pode cair no modo
+    // compacto, mas um veículo posterior com menos itens livres volta à tabela
+    // completa, que ocupa mais: vale o maior dos dois layouts possíveis.
+    size_t maior = 0;
     for (int i = 0; i < qtd_veiculos; i++) {
-        processar_carga(frota[i], itens, qtd_itens, saida);
+        int W = frota[i].cap_peso, V = frota[i].cap_volume;
+        if (motor == MOTOR_PARETO || motor == MOTOR_BB) break;
+        if (motor == MOTOR_AUTO && (double)(W + 1) * (V + 1) > LIMITE_CELULAS_DENSA) continue;
+        LayoutDP L = planejar_dp(qtd_itens, W, V, sizeof(double));
+        if (L.bytes > maior) maior = L.bytes;
+        if (L.compacto && modo_dp == DP_AUTO) {
+            // Maior n que ainda fica na tabela completa
+            long long n_completa = LIMITE_DP_COMPLETA / (long long)L.camada - 1;
+            if (n_completa >= 0) {
+                LayoutDP C = planejar_dp((int)n_completa, W, V, sizeof(double));
+                if (C.bytes > maior) maior = C.bytes;
+            }
+        }
+    }
+    Arena arena;
+    memset(&arena, 0, sizeof(Arena));
+    arena_reservar(&arena, maior + 2 * ((size_t)qtd_itens + 1) * sizeof(int) + 128);
+
+    // Processar Veículos
+    if (modo_frota == FROTA_GLOBAL) {
+        // Todos os itens são divididos antes e as linhas saem na ordem do arquivo
+        int *dono = (int *)malloc((qtd_itens + 1) * sizeof(int));
+        int *escolhidos = (int *)malloc((qtd_itens + 1) * sizeof(int));
+        alocar_frota(frota, qtd_veiculos, itens, qtd_itens, dono, &arena);
+        for (int v = 0; v < qtd_veiculos; v++) {
+            int qtd = 0;
+            for (int i = qtd_itens - 1; i >= 0; i--) {
+                if (dono[i] == v) escolhidos[qtd++] = i;
+            }
+            escrever_carga(frota[v], itens, escolhidos, qtd, &saida);
+        }
+        free(dono);
+        free(escolhidos);
+    } else {
+        for (int i = 0; i < qtd_veiculos; i++) {
+            processar_carga(frota[i], itens, qtd_itens, &saida, &arena);
+        }
     }
+    arena_liberar(&arena);
 
     // Processar Pendentes
     double valor_pendente = 0;
+    int64_t centavos_pendente = 0;
     int peso_pendente = 0;
     int vol_pendente = 0;
     
     for (int i = 0; i < qtd_itens; i++) {
         if (!itens[i].carregado) {
             valor_pendente += itens[i].valor;
+            centavos_pendente += itens[i].centavos;
             peso_pendente += itens[i].peso;
             vol_pendente += itens[i].volume;
         }
     }
 
-    fprintf(saida, "PENDENTE:R$%.2f,%dKG,%dL->", valor_pendente, peso_pendente, vol_pendente);
+    if (modo_valor == VALOR_CENTAVOS) valor_pendente = centavos_pendente / 100.0;
+    esc_txt(&saida, "PENDENTE:R$");
+    esc_real2(&saida, valor_pendente);
+    esc_char(&saida, ',');
+    esc_int(&saida, peso_pendente);
+    esc_txt(&saida, "KG,");
+    esc_int(&saida, vol_pendente);
+    esc_txt(&saida, "L->");
     
     int primeiro = 1;
     for (int i = 0; i < qtd_itens; i++) {
         if (!itens[i].carregado) {
             if (!primeiro) {
-                fprintf(saida, ",");
+                esc_char(&saida, ',');
             }
-            fprintf(saida, "%s", itens[i].codigo);
+            esc_txt(&saida, itens[i].codigo);
             primeiro = 0;
         }
     }
-    fprintf(saida, "\n");
+    esc_char(&saida, '\n');
 
-    fclose(saida);
+    esc_flush(&saida);
+    fclose(saida.f);
+    free(saida.v);
     free(frota);
     free(itens);
-    
+
+    if (qtd_v) *qtd_v = qtd_veiculos;
+    if (qtd_i) *qtd_i = qtd_itens;
+    return 0;
+}
+
+typedef struct {
+    char entrada[1024];
+    char saida[1024];
+    long tam;       // Bytes do arquivo, para começar pelos maiores
+    int pos;        // Posição na lista original
+    int veiculos;
+    int itens;
+    double tempo;
+    int erro;
+} Manifesto;
+
+int comparar_tam_desc(const void *a, const void *b) {
+    long x = ((const Manifesto *)a)->tam, y = ((const Manifesto *)b)->tam;
+    return (x < y) - (x > y);
+}
+
+int comparar_entrada(const void *a, const void *b) {
+    return strcmp(((const Manifesto *)a)->entrada, ((const Manifesto *)b)->entrada);
+}
+
+int comparar_saida(const void *a, const void *b) {
+    return strcmp((*(Manifesto *const *)a)->saida, (*(Manifesto *const *)b)->saida);
+}
+
+int termina_com(const char *s, const char *sufixo) {
+    size_t n = strlen(s), k = strlen(sufixo);
+    return n >= k && strcmp(s + n - k, sufixo) == 0;
+}
+
+int e_diretorio(const char *caminho) {
+    struct stat st;
+    return stat(caminho, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Acrescenta um manifesto à lista; a saída é <pasta_saida>/<nome>.saida.txt
+void adicionar_manifesto(Manifesto **lista, int *n, int *cap, const char *entrada, const char *pasta_saida) {
+    if (*n == *cap) {
+        *cap = *cap ? 2 * *cap : 16;
+        *lista = (Manifesto *)realloc(*lista, *cap * sizeof(Manifesto));
+    }
+    Manifesto *m = &(*lista)[(*n)++];
+    memset(m, 0, sizeof(Manifesto));
+    snprintf(m->entrada, sizeof(m->entrada), "%s", entrada);
+    const char *nome = entrada;
+    for (const char *c = entrada; *c; c++) {
+        if (*c == '/' || *c == '\\') nome = c + 1;
+    }
+    snprintf(m->saida, sizeof(m->saida), "%s/%s.saida.txt", pasta_saida, nome);
+    struct stat st;
+    m->tam = (stat(entrada, &st) == 0) ? (long)st.st_size : 0;
+}
+
+// Manifestos de pastas diferentes com o mesmo nome (a/rota.txt e b/rota.txt)
+// cairiam no mesmo arquivo de saída, escrito por duas threads ao mesmo tempo.
+// Esses passam a ser <pasta_saida>/<posição na lista>_<nome>.saida.txt; se
+// ainda sobrar colisão, o lote é recusado. Retorna 0 nesse caso.
+int saidas_unicas(Manifesto *lista, int n, const char *pasta_saida) {
+    Manifesto **ord = (Manifesto **)malloc(n * sizeof(Manifesto *));
+    int ok = 1;
+    for (int rodada = 0; rodada < 2 && ok; rodada++) {
+        for (int i = 0; i < n; i++) ord[i] = &lista[i];
+        qsort(ord, n, sizeof(Manifesto *), comparar_saida);
+        int repetidos = 0;
+        for (int i = 0; i < n;) {
+            int j = i + 1;
+            while (j < n && strcmp(ord[i]->saida, ord[j]->saida) == 0) j++;
+            if (j - i > 1) {
+                repetidos = 1;
+                if (rodada == 1) {
+                    printf("Saida repetida no lote: %s (de %s e %s)\n", ord[i]->saida, ord[i]->entrada,
+                           ord[i + 1]->entrada);
+                    ok = 0;
+                    break;
+                }
+                for (int k = i; k < j; k++) {
+                    Manifesto *m = ord[k];
+                    const char *nome = m->entrada;
+                    for (const char *c = m->entrada; *c; c++) {
+                        if (*c == '/' || *c == '\\') nome = c + 1;
+                    }
+                    int t = snprintf(m->saida, sizeof(m->saida), "%s/%d_%s.saida.txt", pasta_saida,
+                                     (int)(m - lista) + 1, nome);
+                    if (t < 0 || t >= (int)sizeof(m->saida)) {
+                        printf("Caminho de saida longo demais para %s\n", m->entrada);
+                        ok = 0;
+                    }
+                }
+            }
+            i = j;
+        }
+        if (!repetidos) break;
+    }
+    free(ord);
+    return ok;
+}
+
+// Modo lote: 'origem' é um diretório (todo arquivo regular dentro dele) ou um
+// arquivo com um caminho de manifesto por linha. Os manifestos são independentes
+// e vão para um pool de threads, maiores primeiro; a DP de cada veículo então
+// roda numa thread só. No fim imprime o tempo de cada manifesto na ordem dada.
+int resolver_lote(const char *origem, const char *pasta_saida) {
+    Manifesto *lista = NULL;
+    int n = 0, cap = 0;
+    char caminho[1024];
+
+    if (e_diretorio(origem)) {
+        DIR *d = opendir(origem);
+        struct dirent *ent;
+        while (d && (ent = readdir(d)) != NULL) {
+            if (ent->d_name[0] == '.') continue;
+            // Saídas de uma rodada anterior com pasta_saida == origem não são manifestos
+            if (termina_com(ent->d_name, ".saida.txt")) continue;
+            snprintf(caminho, sizeof(caminho), "%s/%s", origem, ent->d_name);
+            if (e_diretorio(caminho)) continue;
+            adicionar_manifesto(&lista, &n, &cap, caminho, pasta_saida);
+        }
+        if (d) closedir(d);
+        // readdir não tem ordem definida: por nome o relatório sai igual em qualquer máquina
+        if (n > 1) qsort(lista, n, sizeof(Manifesto), comparar_entrada);
+    } else {
+        FILE *f = fopen(origem, "r");
+        if (!f) {
+            printf("Erro ao abrir lista de manifestos: %s\n", origem);
+            return 1;
+        }
+        while (fgets(caminho, sizeof(caminho), f)) {
+            caminho[strcspn(caminho, "\r\n")] = '\0';
+            if (caminho[0]) adicionar_manifesto(&lista, &n, &cap, caminho, pasta_saida);
+        }
+        fclose(f);
+    }
+    if (n == 0) {
+        printf("Nenhum manifesto encontrado em %s\n", origem);
+        free(lista);
+        return 1;
+    }
+    if (!saidas_unicas(lista, n, pasta_saida)) {
+        free(lista);
+        return 1;
+    }
+
+    // Fila de execução (maiores primeiro) e onde cada um foi parar nela
+    int *ordem = (int *)malloc(n * sizeof(int));
+    Manifesto *fila = (Manifesto *)malloc(n * sizeof(Manifesto));
+    for (int i = 0; i < n; i++) lista[i].pos = i;
+    memcpy(fila, lista, n * sizeof(Manifesto));
+    qsort(fila, n, sizeof(Manifesto), comparar_tam_desc);
+    for (int i = 0; i < n; i++) ordem[fila[i].pos] = i;
+
+    double t0 = agora();
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int i = 0; i < n; i++) {
+        double ti = agora();
+        fila[i].erro = resolver_manifesto(fila[i].entrada, fila[i].saida, &fila[i].veiculos, &fila[i].itens);
+        fila[i].tempo = agora() - ti;
+    }
+    double total = agora() - t0;
+
+    int erros = 0;
+    for (int i = 0; i < n; i++) {
+        const Manifesto *m = &fila[ordem[i]];
+        if (m->erro) {
+            printf("%s: ERRO\n", m->entrada);
+            erros++;
+        } else {
+            printf("%s: %d veiculos, %d itens, %.3f s -> %s\n", m->entrada, m->veiculos, m->itens, m->tempo, m->saida);
+        }
+    }
+    printf("Lote: %d manifestos (%d com erro) em %.3f s\n", n, erros, total);
+
+    free(ordem);
+    free(fila);
+    free(lista);
+    return erros ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    // --gerar e --bench têm opções próprias e não pedem os dois arquivos
+    int gerador = argc >= 2 && (strcmp(argv[1], "--gerar") == 0 || strcmp(argv[1], "--bench") == 0);
+
+    // Validação de argumentos para evitar erro se não passar os arquivos
+    if (argc < 2 || (!gerador && argc < 3)) {
+        printf("Uso: %s <entrada> <saida> [opcoes]\n"
+               "     %s --lote <diretorio|lista> <pasta_saida> [opcoes]\n"
+               "Opcoes: [--dp auto|completa|compacta] [--kernel auto|avx2|sse2|escalar]\n"
+               "        [--valores real|centavos] [--motor auto|dp|pareto|bb]\n"
+               "        [--tempo-bb segundos] [--frota sequencial|global] [--tempo-frota segundos]\n"
+               "     %s --gerar <arquivo> [--veiculos N] [--itens N] [--cap N] [--corr nenhuma|forte|soma]\n"
+               "     %s --bench [--itens N] [--cap N_max] [--corr nenhuma|forte|soma] [--tempo-bb segundos]\n",
+               argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    if (gerador) {
+        int bench = strcmp(argv[1], "--bench") == 0;
+        // No bench, sem --corr roda as três correlações
+        ParamGerador g = {10, 1000, 200, bench ? -1 : CORR_NENHUMA, 0};
+        int cap_max = 800;
+        double tempo_limite = 2.0;
+        int i = bench ? 2 : 3;
+        if (!bench && argc < 3) {
+            printf("Uso: --gerar <arquivo> [--veiculos N] [--itens N] [--cap N] [--corr nenhuma|forte|soma] "
+                   "[--semente N]\n");
+            return 1;
+        }
+        if (bench) g.itens = 200;
+        for (; i < argc; i++) {
+            if (strcmp(argv[i], "--veiculos") == 0 && i + 1 < argc) g.veiculos = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--itens") == 0 && i + 1 < argc) g.itens = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--cap") == 0 && i + 1 < argc) g.cap = cap_max = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) g.semente = strtoull(argv[++i], NULL, 10);
+            else if (strcmp(argv[i], "--tempo-bb") == 0 && i + 1 < argc) tempo_limite = atof(argv[++i]);
+            else if (strcmp(argv[i], "--corr") == 0 && i + 1 < argc) {
+                i++;
+                if (strcmp(argv[i], "nenhuma") == 0) g.corr = CORR_NENHUMA;
+                else if (strcmp(argv[i], "forte") == 0) g.corr = CORR_FORTE;
+                else if (strcmp(argv[i], "soma") == 0) g.corr = CORR_SOMA;
+                else {
+                    printf("Correlacao invalida: %s\n", argv[i]);
+                    return 1;
+                }
+            } else {
+                printf("Opcao desconhecida: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        if (g.veiculos < 1 || g.itens < 1 || g.cap < 2) {
+            printf("Parametros do gerador invalidos\n");
+            return 1;
+        }
+        if (bench) {
+            escolher_kernel("auto");
+            executar_bench(&g, cap_max, tempo_limite);
+            return 0;
+        }
+        return gerar_manifesto(argv[2], &g);
+    }
+
+    // --lote vem antes dos dois caminhos
+    int lote = strcmp(argv[1], "--lote") == 0;
+    if (lote) {
+        argv++;
+        argc--;
+        if (argc < 3) {
+            printf("Uso: --lote <diretorio|lista> <pasta_saida>\n");
+            return 1;
+        }
+    }
+
+    const char *kernel = "auto";
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            kernel = argv[++i];
+        } else if (strcmp(argv[i], "--motor") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "auto") == 0) motor = MOTOR_AUTO;
+            else if (strcmp(argv[i], "dp") == 0) motor = MOTOR_DP;
+            else if (strcmp(argv[i], "pareto") == 0) motor = MOTOR_PARETO;
+            else if (strcmp(argv[i], "bb") == 0) motor = MOTOR_BB;
+            else {
+                printf("Motor invalido: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--frota") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "sequencial") == 0) modo_frota = FROTA_SEQUENCIAL;
+            else if (strcmp(argv[i], "global") == 0) modo_frota = FROTA_GLOBAL;
+            else {
+                printf("Modo de frota invalido: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--tempo-frota") == 0 && i + 1 < argc) {
+            tempo_frota = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tempo-bb") == 0 && i + 1 < argc) {
+            tempo_bb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--valores") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "real") == 0) modo_valor = VALOR_REAL;
+            else if (strcmp(argv[i], "centavos") == 0) modo_valor = VALOR_CENTAVOS;
+            else {
+                printf("Modo de valores invalido: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--dp") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "completa") == 0) modo_dp = DP_COMPLETA;
+            else if (strcmp(argv[i], "compacta") == 0) modo_dp = DP_COMPACTA;
+            else if (strcmp(argv[i], "auto") == 0) modo_dp = DP_AUTO;
+            else {
+                printf("Modo de DP invalido: %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            printf("Opcao desconhecida: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!escolher_kernel(kernel)) {
+        printf("Kernel indisponivel nesta CPU: %s\n", kernel);
+        return 1;
+    }
+
+    if (lote) {
+        return resolver_lote(argv[1], argv[2]);
+    }
+
+    if (resolver_manifesto(argv[1], argv[2], NULL, NULL) != 0) {
+        return 1;
+    }
+
     printf("Processamento concluido com sucesso.\n");
 
     return 0;
@@ -17,6 +17,13 @@
 #include <time.h>
 #include <ctype.h>
 
+/* AES-NI só existe em x86; o uso depende do CPUID em tempo de execução */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define TEM_AESNI 1
+    #include <cpuid.h>
+    #include <wmmintrin.h>
+#endif
+
 /* --- CONSTANTES E MACROS --- */
 
 /* 16384 bits para garantir que cálculos de chaves 4096-bit não tenham overflow */
@@ -24,6 +31,12 @@
 #define WORD_SIZE       32
 #define MAX_WORDS       (MAX_BITS / WORD_SIZE)
 
+/* AES: 1 = tabelas T de 32 bits (SubBytes+ShiftRows+MixColumns em 4 consultas
+ * por coluna), 0 = implementação byte a byte de referência. -DAES_TTABLE=0 */
+#ifndef AES_TTABLE
+    #define AES_TTABLE 1
+#endif
+
 /* 50MB DE BUFFER: Essencial para não cortar linhas gigantes de teste */
 #define MAX_BUFFER_IO   52428800 
 
@@ -40,8 +53,54 @@ typedef struct {
     int length;
 } ALIGN_OPT BigInt;
 
+/* Limbs do BigNum: 64 bits com produto em __int128 quando o compilador tem */
+#if defined(__SIZEOF_INT128__)
+    typedef uint64_t limb_t;
+    __extension__ typedef unsigned __int128 dlimb_t;
+    #define LIMB_BITS 64
+#else
+    typedef uint32_t limb_t;
+    typedef uint64_t dlimb_t;
+    #define LIMB_BITS 32
+#endif
+
+/* Abaixo disso (em limbs) Comba direto é mais rápido que dividir em Karatsuba */
+#define KARATSUBA_LIMIAR 24
+
+/* Limbs para guardar uma string hex de n dígitos (mínimo 1) */
+#define LIMBS_HEX(n)    (((n) + LIMB_BITS / 4 - 1) / (LIMB_BITS / 4) + 1)
+
+/* Inteiro sem sinal só com os limbs ativos; d[0] é o menos significativo */
+typedef struct {
+    limb_t *d;
+    int len;
+} BigNum;
+
+/* Rascunho do DH: alocar é só avançar um deslocamento e tudo
+ * volta de uma vez ao fim da operação */
+typedef struct {
+    limb_t *base;
+    size_t cap;         /* em limbs */
+    size_t usado;
+} Arena;
+
+/* Contexto de Montgomery para um módulo ímpar n, com R = 2^(LIMB_BITS*len) */
+typedef struct {
+    const limb_t *n;
+    limb_t *r2;         /* R^2 mod n, para entrar no domínio */
+    limb_t *t;          /* Produto completo antes da redução (2*len + 1 limbs) */
+    limb_t *w;          /* Rascunho do Karatsuba */
+    limb_t n0;          /* -n^-1 mod 2^LIMB_BITS */
+    int len;
+} MontCtx;
+
 typedef struct {
     uint32_t round_keys[60];
+    uint32_t dec_keys[60];     /* Cifra inversa equivalente (tabelas T): ordem invertida + InvMixColumns */
+#ifdef TEM_AESNI
+    uint8_t ni_enc[15][16];    /* Chaves em ordem de bytes para AESENC */
+    uint8_t ni_dec[15][16];    /* Ordem invertida + AESIMC para AESDEC */
+#endif
     int nr;
 } AES_Context;
 
@@ -206,18 +265,20 @@ void bi_sub(BigInt *a, const BigInt *b) {
 }
 
 void bi_mul(const BigInt *a, const BigInt *b, BigInt *res) {
-    static uint32_t tmp_words[MAX_WORDS]; 
+    /* Local (não static) para ser reentrante; res pode ser a ou b */
+    uint32_t tmp_words[MAX_WORDS];
     int res_len = a->length + b->length;
     if (res_len > MAX_WORDS) res_len = MAX_WORDS;
 
     memset(tmp_words, 0, res_len * sizeof(uint32_t));
 
-    for (int i = 0; i < a->length; i++) {
+    for (int i = 0; i < a->length && i < MAX_WORDS; i++) {
         uint64_t carry = 0;
         uint32_t wa = a->words[i];
+        /* Limite fora do laço interno em vez de testar a cada palavra */
+        int fim_j = (b->length < MAX_WORDS - i) ? b->length : MAX_WORDS - i;
         
-        for (int j = 0; j < b->length; j++) {
-            if (i + j >= MAX_WORDS) break;
+        for (int j = 0; j < fim_j; j++) {
             uint64_t prod = (uint64_t)wa * b->words[j] + tmp_words[i + j] + carry;
             tmp_words[i + j] = (uint32_t)prod;
             carry = prod >> 32;
@@ -419,6 +480,364 @@ void hex_to_bi(const char *hex, BigInt *res) {
     bi_trim(res);
 }
 
+/* --- BIGNUM DE TAMANHO VARIÁVEL (caminho do DH) --- */
+
+void arena_reservar(Arena *a, size_t limbs) {
+    if (limbs <= a->cap) return;
+    free(a->base);
+    a->base = malloc(limbs * sizeof(limb_t));
+    a->cap = a->base ? limbs : 0;
+}
+
+limb_t *arena_alocar(Arena *a, size_t limbs) {
+    if (a->usado + limbs > a->cap) {
+        fprintf(stderr, "Arena do BigNum esgotada\n");
+        exit(1);
+    }
+    limb_t *p = a->base + a->usado;
+    a->usado += limbs;
+    return p;
+}
+
+void arena_liberar(Arena *a) {
+    free(a->base);
+    a->base = NULL;
+    a->cap = a->usado = 0;
+}
+
+void bn_trim(BigNum *n) {
+    while (n->len > 1 && n->d[n->len - 1] == 0) n->len--;
+}
+
+int bn_msb(const BigNum *n) {
+    for (int i = n->len - 1; i >= 0; i--) {
+        if (n->d[i] != 0) {
+            for (int bit = LIMB_BITS - 1; bit >= 0; bit--) {
+                if ((n->d[i] >> bit) & 1) return i * LIMB_BITS + bit;
+            }
+        }
+    }
+    return -1;
+}
+
+int bn_get_bit(const BigNum *n, int pos) {
+    int idx = pos / LIMB_BITS;
+    if (idx >= n->len) return 0;
+    return (int)((n->d[idx] >> (pos % LIMB_BITS)) & 1);
+}
+
+/* Palavra de 32 bits de índice i (0 além do tamanho), como em BigInt.words */
+uint32_t bn_word(const BigNum *n, int i) {
+    int idx = i / (LIMB_BITS / 32);
+    if (idx >= n->len) return 0;
+    return (uint32_t)(n->d[idx] >> (32 * (i % (LIMB_BITS / 32))));
+}
+
+void hex_to_bn(const char *hex, BigNum *res, Arena *arena) {
+    int len = strlen(hex);
+    int por_limb = LIMB_BITS / 4;
+    res->len = (len + por_limb - 1) / por_limb;
+    if (res->len == 0) res->len = 1;
+    res->d = arena_alocar(arena, res->len);
+    for (int i = 0; i < res->len; i++) {
+        limb_t w = 0;
+        int end = len - (i * por_limb);
+        int start = end - por_limb; if (start < 0) start = 0;
+        for (int k = start; k < end; k++) w = (w << 4) | parse_hex(hex[k]);
+        res->d[i] = w;
+    }
+    bn_trim(res);
+}
+
+int bn_cmp_n(const limb_t *a, const limb_t *b, int n) {
+    for (int i = n - 1; i >= 0; i--) {
+        if (a[i] != b[i]) return (a[i] > b[i]) ? 1 : -1;
+    }
+    return 0;
+}
+
+/* r = a - b em n limbs (r pode ser a); retorna o empréstimo */
+limb_t bn_sub_n(limb_t *r, const limb_t *a, const limb_t *b, int n) {
+    limb_t borrow = 0;
+    for (int i = 0; i < n; i++) {
+        limb_t ai = a[i], bi = b[i];
+        limb_t d = ai - bi - borrow;
+        borrow = (ai < bi) || (ai == bi && borrow);
+        r[i] = d;
+    }
+    return borrow;
+}
+
+/* x = (2x + bit) mod n, com x < n em len limbs */
+void bn_dobrar_mod(limb_t *x, int bit, const limb_t *n, int len) {
+    limb_t carry = x[len - 1] >> (LIMB_BITS - 1);
+    for (int i = len - 1; i > 0; i--) x[i] = (x[i] << 1) | (x[i - 1] >> (LIMB_BITS - 1));
+    x[0] = (x[0] << 1) | (limb_t)bit;
+    if (carry || bn_cmp_n(x, n, len) >= 0) bn_sub_n(x, x, n, len);
+}
+
+/* r = x mod n em len limbs. A base do DH costuma já ser menor que p;
+ * senão, Horner bit a bit (só roda uma vez por exponenciação) */
+void bn_reduzir(const BigNum *x, const limb_t *n, int len, limb_t *r) {
+    if (x->len <= len) {
+        memset(r, 0, len * sizeof(limb_t));
+        memcpy(r, x->d, x->len * sizeof(limb_t));
+        if (bn_cmp_n(r, n, len) < 0) return;
+    }
+    memset(r, 0, len * sizeof(limb_t));
+    for (int i = bn_msb(x); i >= 0; i--) bn_dobrar_mod(r, bn_get_bit(x, i), n, len);
+}
+
+limb_t bn_add_n(limb_t *r, const limb_t *a, const limb_t *b, int n) {
+    limb_t carry = 0;
+    for (int i = 0; i < n; i++) {
+        dlimb_t p = (dlimb_t)a[i] + b[i] + carry;
+        r[i] = (limb_t)p;
+        carry = (limb_t)(p >> LIMB_BITS);
+    }
+    return carry;
+}
+
+/* r[0..rn) += x[0..xn), xn <= rn; retorna o vai-um que sobrar */
+limb_t bn_add_em(limb_t *r, int rn, const limb_t *x, int xn) {
+    limb_t carry = bn_add_n(r, r, x, xn);
+    for (int i = xn; carry && i < rn; i++) carry = (++r[i] == 0);
+    return carry;
+}
+
+/* r[0..rn) -= x[0..xn), xn <= rn */
+limb_t bn_sub_em(limb_t *r, int rn, const limb_t *x, int xn) {
+    limb_t borrow = bn_sub_n(r, r, x, xn);
+    for (int i = xn; borrow && i < rn; i++) borrow = (r[i]-- == 0);
+    return borrow;
+}
+
+/* r = |x - y| em nx limbs, com y de ny <= nx limbs; retorna 1 se x < y */
+int bn_dif_abs(limb_t *r, const limb_t *x, int nx, const limb_t *y, int ny) {
+    int menor = 0;
+    int i = nx - 1;
+    while (i >= ny && x[i] == 0) i--;
+    if (i < ny) menor = bn_cmp_n(x, y, ny) < 0;
+    if (menor) {
+        memset(r, 0, nx * sizeof(limb_t));
+        bn_sub_n(r, y, x, ny);
+    } else {
+        memcpy(r, x, nx * sizeof(limb_t));
+        bn_sub_em(r, nx, y, ny);
+    }
+    return menor;
+}
+
+/* --- MULTIPLICAÇÃO: COMBA, QUADRADO E KARATSUBA --- */
+
+/* Soma o produto na coluna: acc tem dois limbs e c2 guarda o terceiro */
+#define COMBA_ACUM(x, y) do { \
+        dlimb_t p_ = (dlimb_t)(x) * (y); \
+        acc += p_; c2 += (acc < p_); \
+    } while (0)
+
+#define COMBA_FECHA(k) do { \
+        r[k] = (limb_t)acc; \
+        acc = (acc >> LIMB_BITS) | ((dlimb_t)c2 << LIMB_BITS); c2 = 0; \
+    } while (0)
+
+/* r[0..2n) = a * b, coluna por coluna (cada limb do resultado é escrito uma vez) */
+void bn_mul_comba(limb_t *r, const limb_t *a, const limb_t *b, int n) {
+    dlimb_t acc = 0;
+    limb_t c2 = 0;
+    for (int k = 0; k < 2 * n - 1; k++) {
+        int i0 = (k < n) ? 0 : k - n + 1;
+        int i1 = (k < n) ? k : n - 1;
+        for (int i = i0; i <= i1; i++) COMBA_ACUM(a[i], b[k - i]);
+        COMBA_FECHA(k);
+    }
+    r[2 * n - 1] = (limb_t)acc;
+}
+
+/* r[0..2n) = a^2: cada a[i]*a[j] fora da diagonal é calculado uma vez e dobrado */
+void bn_sqr_comba(limb_t *r, const limb_t *a, int n) {
+    dlimb_t acc = 0;
+    limb_t c2 = 0;
+    for (int k = 0; k < 2 * n - 1; k++) {
+        int i0 = (k < n) ? 0 : k - n + 1;
+        dlimb_t t = 0;
+        limb_t tc = 0;
+        for (int i = i0; i < k - i; i++) {
+            dlimb_t p = (dlimb_t)a[i] * a[k - i];
+            t += p; tc += (t < p);
+        }
+        acc += t; c2 += tc + (acc < t);
+        acc += t; c2 += tc + (acc < t);
+        if ((k & 1) == 0) COMBA_ACUM(a[k / 2], a[k / 2]);
+        COMBA_FECHA(k);
+    }
+    r[2 * n - 1] = (limb_t)acc;
+}
+
+/* Limbs de rascunho que bn_mul_kara usa para operandos de n limbs */
+size_t karatsuba_rascunho(int n) {
+    if (n < KARATSUBA_LIMIAR) return 0;
+    int m = (n + 1) / 2;
+    return 6 * (size_t)m + 1 + karatsuba_rascunho(m);
+}
+
+/* r[0..2n) = a * b; com a == b vira quadrado em todos os níveis.
+ * a = a1*B^m + a0: a0*b1 + a1*b0 = z0 + z2 - (a0-a1)(b0-b1), três produtos
+ * de meio tamanho em vez de quatro. */
+void bn_mul_kara(limb_t *r, const limb_t *a, const limb_t *b, int n, limb_t *w) {
+    int quad = (a == b);
+    if (n < KARATSUBA_LIMIAR) {
+        if (quad) bn_sqr_comba(r, a, n);
+        else bn_mul_comba(r, a, b, n);
+        return;
+    }
+
+    int m = (n + 1) / 2;
+    int h = n - m;
+    limb_t *da = w;
+    limb_t *db = w + m;
+    limb_t *d = w + 2 * m;
+    limb_t *t = w + 4 * m;
+    limb_t *prox = w + 6 * m + 1;
+
+    /* z0 = a0*b0 em r[0..2m), z2 = a1*b1 em r[2m..2n) */
+    bn_mul_kara(r, a, b, m, prox);
+    bn_mul_kara(r + 2 * m, a + m, b + m, h, prox);
+
+    int neg = bn_dif_abs(da, a, m, a + m, h);
+    if (quad) {
+        neg = 0;
+        bn_mul_kara(d, da, da, m, prox);
+    } else {
+        neg ^= bn_dif_abs(db, b, m, b + m, h);
+        bn_mul_kara(d, da, db, m, prox);
+    }
+
+    /* meio = z0 + z2 -/+ d, cabe em 2m + 1 limbs */
+    memcpy(t, r, 2 * m * sizeof(limb_t));
+    t[2 * m] = 0;
+    bn_add_em(t, 2 * m + 1, r + 2 * m, 2 * h);
+    if (neg) bn_add_em(t, 2 * m + 1, d, 2 * m);
+    else bn_sub_em(t, 2 * m + 1, d, 2 * m);
+
+    bn_add_em(r + m, 2 * n - m, t, 2 * m + 1);
+}
+
+/* --- EXPONENCIAÇÃO EM DOMÍNIO DE MONTGOMERY --- */
+
+/* Prepara o contexto uma vez por módulo. Retorna 0 se n for par ou 1
+ * (Montgomery não se aplica); o chamador usa bi_pow_mod. */
+int mont_init(MontCtx *m, const BigNum *mod, Arena *arena) {
+    if (!(mod->d[0] & 1)) return 0;
+    if (mod->len == 1 && mod->d[0] == 1) return 0;
+
+    int s = mod->len;
+    m->n = mod->d;
+    m->len = s;
+    m->r2 = arena_alocar(arena, s);
+    m->t = arena_alocar(arena, 2 * s + 1);
+    m->w = arena_alocar(arena, karatsuba_rascunho(s));
+
+    /* Newton: cada passo dobra os bits corretos de n^-1 (3 -> 96) */
+    limb_t inv = mod->d[0];
+    for (int k = 0; k < 5; k++) inv *= 2 - mod->d[0] * inv;
+    m->n0 = (limb_t)0 - inv;
+
+    /* R^2 = 2^(2*LIMB_BITS*len) mod n por duplicações, sem divisão */
+    memset(m->r2, 0, s * sizeof(limb_t));
+    m->r2[0] = 1;
+    for (int i = 0; i < 2 * LIMB_BITS * s; i++) bn_dobrar_mod(m->r2, 0, m->n, s);
+    return 1;
+}
+
+/* res = a * b * R^-1 mod n. O produto completo vem do Comba/Karatsuba
+ * (quadrado dedicado quando a == b, que é a maioria na exponenciação) e
+ * a redução de Montgomery é feita depois, limb a limb.
+ * Entradas < n com len limbs; res pode ser a ou b. */
+void mont_mul(limb_t *res, const limb_t *a, const limb_t *b, const MontCtx *m) {
+    int s = m->len;
+    const limb_t *n = m->n;
+    limb_t *t = m->t;
+
+    bn_mul_kara(t, a, b, s, m->w);
+    t[2 * s] = 0;
+
+    for (int i = 0; i < s; i++) {
+        /* q zera t[i]; ao fim, t[s..2s] = t * R^-1 */
+        limb_t q = t[i] * m->n0;
+        limb_t carry = 0;
+        for (int j = 0; j < s; j++) {
+            dlimb_t p = (dlimb_t)q * n[j] + t[i + j] + carry;
+            t[i + j] = (limb_t)p;
+            carry = (limb_t)(p >> LIMB_BITS);
+        }
+        for (int k = i + s; carry && k <= 2 * s; k++) {
+            dlimb_t p = (dlimb_t)t[k] + carry;
+            t[k] = (limb_t)p;
+            carry = (limb_t)(p >> LIMB_BITS);
+        }
+    }
+
+    /* t[s..2s] < 2n: uma subtração condicional basta */
+    if (t[2 * s] != 0 || bn_cmp_n(t + s, n, s) >= 0) bn_sub_n(res, t + s, n, s);
+    else memcpy(res, t + s, s * sizeof(limb_t));
+}
+
+/* Mesma janela de 4 bits de bi_pow_mod, sem nenhuma divisão no laço.
+ * 'res' fica na arena; a tabela e o acumulador voltam ao fim. */
+void bn_pow_mod_mont(const BigNum *base, const BigNum *exp, const MontCtx *m, BigNum *res, Arena *arena) {
+    int s = m->len;
+    res->d = arena_alocar(arena, s);
+
+    if (bn_msb(exp) < 0) {
+        res->d[0] = 1; res->len = 1; return;
+    }
+
+    size_t marca = arena->usado;
+    limb_t *table = arena_alocar(arena, 16 * (size_t)s);
+    limb_t *acc = arena_alocar(arena, s);
+    limb_t *um = arena_alocar(arena, s);
+
+    memset(um, 0, s * sizeof(limb_t));
+    um[0] = 1;
+
+    /* base mod n convertida para o domínio: x*R = mont(x, R^2) */
+    bn_reduzir(base, m->n, s, table + s);
+    mont_mul(table + s, table + s, m->r2, m);
+
+    mont_mul(table, um, m->r2, m);   /* 1 no domínio = R mod n */
+    for (int i = 2; i < 16; i++) mont_mul(table + i * s, table + (i - 1) * s, table + s, m);
+
+    memcpy(acc, table, s * sizeof(limb_t));
+
+    int i = bn_msb(exp);
+
+    while (i >= 0) {
+        if (bn_get_bit(exp, i) == 0) {
+            mont_mul(acc, acc, acc, m);
+            i--;
+        } else {
+            int window = 0;
+            int val = 0;
+            for (int k = 0; k < 4 && i - k >= 0; k++) {
+                val = (val << 1) | bn_get_bit(exp, i - k);
+                window++;
+            }
+
+            for (int k = 0; k < window; k++) mont_mul(acc, acc, acc, m);
+            mont_mul(acc, acc, table + val * s, m);
+
+            i -= window;
+        }
+    }
+
+    /* Sai do domínio: mont(acc, 1) = acc * R^-1 */
+    mont_mul(res->d, acc, um, m);
+    res->len = s;
+    bn_trim(res);
+    arena->usado = marca;
+}
+
 uint8_t gmul(uint8_t a, uint8_t b) {
     uint8_t p = 0;
     for (int i = 0; i < 8; i++) {
@@ -435,6 +854,38 @@ uint32_t sub_word(uint32_t w) {
 
 uint32_t rot_word(uint32_t w) { return (w << 8) | (w >> 24); }
 
+#if AES_TTABLE
+/* Te[k][x]: coluna de MixColumns da S-box de x na linha k; Td idem para a inversa */
+static uint32_t Te[4][256], Td[4][256];
+
+#define ROR8(w)         (((w) >> 8) | ((w) << 24))
+#define CARREGA32(p)    (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | ((uint32_t)(p)[2] << 8) | (uint32_t)(p)[3])
+#define GUARDA32(p, w)  do { (p)[0] = (uint8_t)((w) >> 24); (p)[1] = (uint8_t)((w) >> 16); \
+                             (p)[2] = (uint8_t)((w) >> 8); (p)[3] = (uint8_t)(w); } while (0)
+
+/* Gera as tabelas a partir das S-boxes (uma vez, 16KB) */
+void aes_tabelas_init(void) {
+    static int pronto = 0;
+    if (pronto) return;
+    for (int x = 0; x < 256; x++) {
+        uint8_t e = sbox[x], d = rsbox[x];
+        Te[0][x] = ((uint32_t)gmul(2, e) << 24) | ((uint32_t)e << 16) | ((uint32_t)e << 8) | gmul(3, e);
+        Td[0][x] = ((uint32_t)gmul(0xe, d) << 24) | ((uint32_t)gmul(0x9, d) << 16) |
+                   ((uint32_t)gmul(0xd, d) << 8) | gmul(0xb, d);
+        for (int k = 1; k < 4; k++) {
+            Te[k][x] = ROR8(Te[k-1][x]);
+            Td[k][x] = ROR8(Td[k-1][x]);
+        }
+    }
+    pronto = 1;
+}
+#endif
+
+#ifdef TEM_AESNI
+int aes_usa_ni = 0;
+void aesni_preparar_chaves(AES_Context *ctx);
+#endif
+
 void expand_key(const uint8_t *key, AES_Context *ctx, int nk) {
     int i = 0;
     while (i < nk) {
@@ -449,6 +900,24 @@ void expand_key(const uint8_t *key, AES_Context *ctx, int nk) {
         ctx->round_keys[i] = ctx->round_keys[i - nk] ^ t;
         i++;
     }
+#if AES_TTABLE
+    /* Chaves da decifração na ordem inversa; as intermediárias passam por
+     * InvMixColumns (Td[S[x]] é InvMixColumns aplicado ao byte x) */
+    aes_tabelas_init();
+    for (int r = 0; r <= ctx->nr; r++) {
+        for (int c = 0; c < 4; c++) {
+            uint32_t w = ctx->round_keys[4 * (ctx->nr - r) + c];
+            if (r > 0 && r < ctx->nr) {
+                w = Td[0][sbox[w >> 24]] ^ Td[1][sbox[(w >> 16) & 0xFF]] ^
+                    Td[2][sbox[(w >> 8) & 0xFF]] ^ Td[3][sbox[w & 0xFF]];
+            }
+            ctx->dec_keys[4 * r + c] = w;
+        }
+    }
+#endif
+#ifdef TEM_AESNI
+    if (aes_usa_ni) aesni_preparar_chaves(ctx);
+#endif
 }
 
 void add_rk(uint8_t *s, const uint32_t *rk) {
@@ -458,6 +927,70 @@ void add_rk(uint8_t *s, const uint32_t *rk) {
     }
 }
 
+#if AES_TTABLE
+
+/* Colunas como palavras big-endian, o mesmo formato de round_keys */
+void aes_enc(const uint8_t *in, uint8_t *out, AES_Context *ctx) {
+    const uint32_t *rk = ctx->round_keys;
+    uint32_t s0 = CARREGA32(in) ^ rk[0];
+    uint32_t s1 = CARREGA32(in + 4) ^ rk[1];
+    uint32_t s2 = CARREGA32(in + 8) ^ rk[2];
+    uint32_t s3 = CARREGA32(in + 12) ^ rk[3];
+    uint32_t t0, t1, t2, t3;
+
+    for (int r = 1; r < ctx->nr; r++) {
+        rk += 4;
+        t0 = Te[0][s0 >> 24] ^ Te[1][(s1 >> 16) & 0xFF] ^ Te[2][(s2 >> 8) & 0xFF] ^ Te[3][s3 & 0xFF] ^ rk[0];
+        t1 = Te[0][s1 >> 24] ^ Te[1][(s2 >> 16) & 0xFF] ^ Te[2][(s3 >> 8) & 0xFF] ^ Te[3][s0 & 0xFF] ^ rk[1];
+        t2 = Te[0][s2 >> 24] ^ Te[1][(s3 >> 16) & 0xFF] ^ Te[2][(s0 >> 8) & 0xFF] ^ Te[3][s1 & 0xFF] ^ rk[2];
+        t3 = Te[0][s3 >> 24] ^ Te[1][(s0 >> 16) & 0xFF] ^ Te[2][(s1 >> 8) & 0xFF] ^ Te[3][s2 & 0xFF] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    /* Última rodada sem MixColumns: só S-box + ShiftRows */
+    rk += 4;
+    t0 = ((uint32_t)sbox[s0 >> 24] << 24) ^ ((uint32_t)sbox[(s1 >> 16) & 0xFF] << 16) ^
+         ((uint32_t)sbox[(s2 >> 8) & 0xFF] << 8) ^ sbox[s3 & 0xFF] ^ rk[0];
+    t1 = ((uint32_t)sbox[s1 >> 24] << 24) ^ ((uint32_t)sbox[(s2 >> 16) & 0xFF] << 16) ^
+         ((uint32_t)sbox[(s3 >> 8) & 0xFF] << 8) ^ sbox[s0 & 0xFF] ^ rk[1];
+    t2 = ((uint32_t)sbox[s2 >> 24] << 24) ^ ((uint32_t)sbox[(s3 >> 16) & 0xFF] << 16) ^
+         ((uint32_t)sbox[(s0 >> 8) & 0xFF] << 8) ^ sbox[s1 & 0xFF] ^ rk[2];
+    t3 = ((uint32_t)sbox[s3 >> 24] << 24) ^ ((uint32_t)sbox[(s0 >> 16) & 0xFF] << 16) ^
+         ((uint32_t)sbox[(s1 >> 8) & 0xFF] << 8) ^ sbox[s2 & 0xFF] ^ rk[3];
+    GUARDA32(out, t0); GUARDA32(out + 4, t1); GUARDA32(out + 8, t2); GUARDA32(out + 12, t3);
+}
+
+void aes_dec(const uint8_t *in, uint8_t *out, AES_Context *ctx) {
+    const uint32_t *rk = ctx->dec_keys;
+    uint32_t s0 = CARREGA32(in) ^ rk[0];
+    uint32_t s1 = CARREGA32(in + 4) ^ rk[1];
+    uint32_t s2 = CARREGA32(in + 8) ^ rk[2];
+    uint32_t s3 = CARREGA32(in + 12) ^ rk[3];
+    uint32_t t0, t1, t2, t3;
+
+    for (int r = 1; r < ctx->nr; r++) {
+        rk += 4;
+        t0 = Td[0][s0 >> 24] ^ Td[1][(s3 >> 16) & 0xFF] ^ Td[2][(s2 >> 8) & 0xFF] ^ Td[3][s1 & 0xFF] ^ rk[0];
+        t1 = Td[0][s1 >> 24] ^ Td[1][(s0 >> 16) & 0xFF] ^ Td[2][(s3 >> 8) & 0xFF] ^ Td[3][s2 & 0xFF] ^ rk[1];
+        t2 = Td[0][s2 >> 24] ^ Td[1][(s1 >> 16) & 0xFF] ^ Td[2][(s0 >> 8) & 0xFF] ^ Td[3][s3 & 0xFF] ^ rk[2];
+        t3 = Td[0][s3 >> 24] ^ Td[1][(s2 >> 16) & 0xFF] ^ Td[2][(s1 >> 8) & 0xFF] ^ Td[3][s0 & 0xFF] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    rk += 4;
+    t0 = ((uint32_t)rsbox[s0 >> 24] << 24) ^ ((uint32_t)rsbox[(s3 >> 16) & 0xFF] << 16) ^
+         ((uint32_t)rsbox[(s2 >> 8) & 0xFF] << 8) ^ rsbox[s1 & 0xFF] ^ rk[0];
+    t1 = ((uint32_t)rsbox[s1 >> 24] << 24) ^ ((uint32_t)rsbox[(s0 >> 16) & 0xFF] << 16) ^
+         ((uint32_t)rsbox[(s3 >> 8) & 0xFF] << 8) ^ rsbox[s2 & 0xFF] ^ rk[1];
+    t2 = ((uint32_t)rsbox[s2 >> 24] << 24) ^ ((uint32_t)rsbox[(s1 >> 16) & 0xFF] << 16) ^
+         ((uint32_t)rsbox[(s0 >> 8) & 0xFF] << 8) ^ rsbox[s3 & 0xFF] ^ rk[2];
+    t3 = ((uint32_t)rsbox[s3 >> 24] << 24) ^ ((uint32_t)rsbox[(s2 >> 16) & 0xFF] << 16) ^
+         ((uint32_t)rsbox[(s1 >> 8) & 0xFF] << 8) ^ rsbox[s0 & 0xFF] ^ rk[3];
+    GUARDA32(out, t0); GUARDA32(out + 4, t1); GUARDA32(out + 8, t2); GUARDA32(out + 12, t3);
+}
+
+#else
+
 void aes_enc(const uint8_t *in, uint8_t *out, AES_Context *ctx) {
     uint8_t s[16]; memcpy(s, in, 16);
     add_rk(s, ctx->round_keys);
@@ -518,9 +1051,116 @@ void aes_dec(const uint8_t *in, uint8_t *out, AES_Context *ctx) {
     memcpy(out, s, 16);
 }
 
+#endif
+
+/* --- CIFRA EM LOTE (ECB) E AES-NI --- */
+
+/* Blocos ECB são independentes: a cifra em lote recebe a mensagem inteira.
+ * A implementação é escolhida uma vez em main (aes_escolher_impl). */
+void aes_ecb_enc_port(const uint8_t *in, uint8_t *out, size_t blocos, AES_Context *ctx) {
+    for (size_t i = 0; i < blocos; i++) aes_enc(in + 16 * i, out + 16 * i, ctx);
+}
+
+void aes_ecb_dec_port(const uint8_t *in, uint8_t *out, size_t blocos, AES_Context *ctx) {
+    for (size_t i = 0; i < blocos; i++) aes_dec(in + 16 * i, out + 16 * i, ctx);
+}
+
+void (*aes_ecb_enc)(const uint8_t *in, uint8_t *out, size_t blocos, AES_Context *ctx) = aes_ecb_enc_port;
+void (*aes_ecb_dec)(const uint8_t *in, uint8_t *out, size_t blocos, AES_Context *ctx) = aes_ecb_dec_port;
+
+#ifdef TEM_AESNI
+
+/* Blocos por iteração: a latência de AESENC cobre ~8 instruções independentes */
+#define AESNI_LOTE 8
+
+/* As palavras big-endian de round_keys já estão na ordem de bytes do AES;
+ * a decifração usa as mesmas chaves invertidas e com InvMixColumns (AESIMC) */
+__attribute__((target("aes,sse2")))
+void aesni_preparar_chaves(AES_Context *ctx) {
+    for (int r = 0; r <= ctx->nr; r++) {
+        for (int c = 0; c < 4; c++) {
+            uint32_t w = ctx->round_keys[4 * r + c];
+            ctx->ni_enc[r][4*c] = w >> 24; ctx->ni_enc[r][4*c+1] = w >> 16;
+            ctx->ni_enc[r][4*c+2] = w >> 8; ctx->ni_enc[r][4*c+3] = w;
+        }
+    }
+    for (int r = 0; r <= ctx->nr; r++) {
+        __m128i k = _mm_loadu_si128((const __m128i *)ctx->ni_enc[ctx->nr - r]);
+        if (r > 0 && r < ctx->nr) k = _mm_aesimc_si128(k);
+        _mm_storeu_si128((__m128i *)ctx->ni_dec[r], k);
+    }
+}
+
+__attribute__((target("aes,sse2")))
+void aes_ecb_enc_ni(const uint8_t *in, uint8_t *out, size_t blocos, AES_Context *ctx) {
+    __m128i rk[15];
+    int nr = ctx->nr;
+    for (int r = 0; r <= nr; r++) rk[r] = _mm_loadu_si128((const __m128i *)ctx->ni_enc[r]);
+
+    size_t i = 0;
+    for (; i + AESNI_LOTE <= blocos; i += AESNI_LOTE) {
+        __m128i b[AESNI_LOTE];
+        for (int k = 0; k < AESNI_LOTE; k++) {
+            b[k] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * (i + k))), rk[0]);
+        }
+        for (int r = 1; r < nr; r++) {
+            for (int k = 0; k < AESNI_LOTE; k++) b[k] = _mm_aesenc_si128(b[k], rk[r]);
+        }
+        for (int k = 0; k < AESNI_LOTE; k++) {
+            _mm_storeu_si128((__m128i *)(out + 16 * (i + k)), _mm_aesenclast_si128(b[k], rk[nr]));
+        }
+    }
+    for (; i < blocos; i++) {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * i)), rk[0]);
+        for (int r = 1; r < nr; r++) b = _mm_aesenc_si128(b, rk[r]);
+        _mm_storeu_si128((__m128i *)(out + 16 * i), _mm_aesenclast_si128(b, rk[nr]));
+    }
+}
+
+__attribute__((target("aes,sse2")))
+void aes_ecb_dec_ni(const uint8_t *in, uint8_t *out, size_t blocos, AES_Context *ctx) {
+    __m128i rk[15];
+    int nr = ctx->nr;
+    for (int r = 0; r <= nr; r++) rk[r] = _mm_loadu_si128((const __m128i *)ctx->ni_dec[r]);
+
+    size_t i = 0;
+    for (; i + AESNI_LOTE <= blocos; i += AESNI_LOTE) {
+        __m128i b[AESNI_LOTE];
+        for (int k = 0; k < AESNI_LOTE; k++) {
+            b[k] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * (i + k))), rk[0]);
+        }
+        for (int r = 1; r < nr; r++) {
+            for (int k = 0; k < AESNI_LOTE; k++) b[k] = _mm_aesdec_si128(b[k], rk[r]);
+        }
+        for (int k = 0; k < AESNI_LOTE; k++) {
+            _mm_storeu_si128((__m128i *)(out + 16 * (i + k)), _mm_aesdeclast_si128(b[k], rk[nr]));
+        }
+    }
+    for (; i < blocos; i++) {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + 16 * i)), rk[0]);
+        for (int r = 1; r < nr; r++) b = _mm_aesdec_si128(b, rk[r]);
+        _mm_storeu_si128((__m128i *)(out + 16 * i), _mm_aesdeclast_si128(b, rk[nr]));
+    }
+}
+
+#endif
+
+/* CPUID.1:ECX bit 25 indica AES-NI; sem ele fica a versão portável */
+void aes_escolher_impl(void) {
+#ifdef TEM_AESNI
+    unsigned int a, b, c, d;
+    if (__get_cpuid(1, &a, &b, &c, &d) && (c & bit_AES)) {
+        aes_usa_ni = 1;
+        aes_ecb_enc = aes_ecb_enc_ni;
+        aes_ecb_dec = aes_ecb_dec_ni;
+    }
+#endif
+}
+
 int main(int argc, char *argv[]) {
     clock_t start_time = clock();
     if (argc < 3) return 1;
+    aes_escolher_impl();
     
     FILE *fin = fopen(argv[1], "r");
     FILE *fout = fopen(argv[2], "w");
@@ -539,6 +1179,7 @@ int main(int argc, char *argv[]) {
     
     AES_Context aes_ctx;
     int aes_ready = 0;
+    Arena arena = {NULL, 0, 0};
     
     for (int op = 0; op < ops; op++) {
         if (fscanf(fin, "%s", tag) != 1) break;
@@ -547,24 +1188,46 @@ int main(int argc, char *argv[]) {
             /* Verifica retorno para evitar warnings */
             if (fscanf(fin, "%s %s %s %s", buf_sa, buf_sb, buf_sg, buf_sp) != 4) break;
             
-            BigInt a, b, g, p, s, pub_a;
-            hex_to_bi(buf_sa, &a); hex_to_bi(buf_sb, &b);
-            hex_to_bi(buf_sg, &g); hex_to_bi(buf_sp, &p);
-            
-            bi_pow_mod(&g, &a, &p, &pub_a);
-            bi_pow_mod(&pub_a, &b, &p, &s);
-            
             int bits = strlen(buf_sa) * 4;
             int klen = (bits <= 128) ? 16 : (bits <= 192 ? 24 : 32);
             int nk = klen / 4;
+            uint32_t s_words[8];
+            
+            /* Todo o rascunho do DH vem da arena, dimensionada pelos tamanhos
+             * lidos: operandos + contexto + 2 resultados + tabela da janela */
+            size_t len_p = LIMBS_HEX(strlen(buf_sp));
+            arena.usado = 0;
+            arena_reservar(&arena, LIMBS_HEX(strlen(buf_sa)) + LIMBS_HEX(strlen(buf_sb)) +
+                                   LIMBS_HEX(strlen(buf_sg)) + 24 * len_p +
+                                   karatsuba_rascunho(len_p) + 16);
+            
+            BigNum a, b, g, p, s, pub_a;
+            hex_to_bn(buf_sa, &a, &arena); hex_to_bn(buf_sb, &b, &arena);
+            hex_to_bn(buf_sg, &g, &arena); hex_to_bn(buf_sp, &p, &arena);
+            
+            /* R^2 mod p é calculado uma vez e serve às duas exponenciações */
+            MontCtx mont;
+            if (mont_init(&mont, &p, &arena)) {
+                bn_pow_mod_mont(&g, &a, &mont, &pub_a, &arena);
+                bn_pow_mod_mont(&pub_a, &b, &mont, &s, &arena);
+                for (int i=0; i<nk; i++) s_words[i] = bn_word(&s, i);
+            } else {
+                /* Módulo par: caminho de tamanho fixo com divisão */
+                BigInt ba, bb, bg, bp, bs, bpub;
+                hex_to_bi(buf_sa, &ba); hex_to_bi(buf_sb, &bb);
+                hex_to_bi(buf_sg, &bg); hex_to_bi(buf_sp, &bp);
+                bi_pow_mod(&bg, &ba, &bp, &bpub);
+                bi_pow_mod(&bpub, &bb, &bp, &bs);
+                for (int i=0; i<nk; i++) s_words[i] = bs.words[i];
+            }
             
             fprintf(fout, "s=");
-            for (int i=nk-1; i>=0; i--) fprintf(fout, "%08X", s.words[i]);
+            for (int i=nk-1; i>=0; i--) fprintf(fout, "%08X", s_words[i]);
             fprintf(fout, "\n");
             
             uint8_t k[32] = {0};
             for (int i=0; i<nk; i++) {
-                uint32_t w = s.words[nk-1-i];
+                uint32_t w = s_words[nk-1-i];
                 k[4*i]=(w>>24)&0xFF; k[4*i+1]=(w>>16)&0xFF; k[4*i+2]=(w>>8)&0xFF; k[4*i+3]=w&0xFF;
             }
             expand_key(k, &aes_ctx, nk);
@@ -603,17 +1266,25 @@ int main(int argc, char *argv[]) {
             
             int enc = (tag[0] == 'e');
             fprintf(fout, "%c=", enc ? 'c' : 'm');
-            for(size_t i=0; i<padded; i+=16) {
-                if(enc) aes_enc(in+i, out+i, &aes_ctx);
-                else aes_dec(in+i, out+i, &aes_ctx);
+            if(enc) aes_ecb_enc(in, out, padded / 16, &aes_ctx);
+            else aes_ecb_dec(in, out, padded / 16, &aes_ctx);
+            
+            /* Saída em hex montada num buffer e escrita de uma vez
+             * (um fprintf por byte custava mais que a própria cifra) */
+            static const char hex_dig[] = "0123456789ABCDEF";
+            char *hex_out = malloc(2 * padded + 1);
+            for(size_t i=0; i<padded; i++) {
+                hex_out[2*i] = hex_dig[out[i] >> 4];
+                hex_out[2*i+1] = hex_dig[out[i] & 0xF];
             }
-            for(size_t i=0; i<padded; i++) fprintf(fout, "%02X", out[i]);
-            fprintf(fout, "\n");
+            hex_out[2*padded] = '\n';
+            fwrite(hex_out, 1, 2 * padded + 1, fout);
             
-            free(in); free(out);
+            free(in); free(out); free(hex_out);
         }
     }
     
+    arena_liberar(&arena);
     fclose(fin);
     fclose(fout);
     